@@ -1,5 +1,19 @@
 #pragma once
 
 #include <hypr/api.hpp>
+#include <hypr/client.hpp>
+#include <hypr/coalescing.hpp>
+#include <hypr/download.hpp>
+#include <hypr/driver.hpp>
+#include <hypr/endpoints.hpp>
+#include <hypr/event_source.hpp>
+#include <hypr/limiter.hpp>
+#include <hypr/memory.hpp>
 #include <hypr/models.hpp>
+#include <hypr/pagination.hpp>
+#include <hypr/recording.hpp>
 #include <hypr/session.hpp>
+#include <hypr/sharded_client.hpp>
+#include <hypr/trace.hpp>
+#include <hypr/transport.hpp>
+#include <hypr/websocket.hpp>
@@ -0,0 +1,178 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#include <coroutine>
+#define HYPR_HAS_COROUTINES
+#endif
+
+#include <hypr/detail/curl_dispatcher.hpp>
+#include <hypr/models.hpp>
+
+namespace hypr {
+
+// Runs a function on some thread of the caller's choosing. Used for resuming
+// coroutines and calling completion handlers.
+using Executor = std::function<void(std::function<void()>)>;
+
+// Sends requests concurrently on a single event loop. `send_async` and `stop`
+// can be called from any thread; everything else is meant to be called from
+// the thread that runs the loop. Requests that are still in flight when the
+// client is destroyed are dropped without calling their handlers.
+//
+// If the number of transfers is limited, requests wait in line until others
+// are complete, and those of higher priority skip ahead.
+class Client {
+public:
+  using handler_t = std::function<void(Response&&)>;
+
+  Client() {
+    dispatcher_.init();
+  }
+
+  void send_async(const Request& request, handler_t handler) {
+    {
+      std::lock_guard lock{mutex_};
+      queue_.push_back({request, callbacks, options, proxy, context,
+                        std::move(handler)});
+    }
+    dispatcher_.multi().wakeup();
+  }
+
+#ifdef HYPR_HAS_COROUTINES
+  class SendOperation {
+  public:
+    SendOperation(Client& client, const Request& request)
+        : client_{client}, request_{request} {}
+
+    bool await_ready() const noexcept {
+      return false;
+    }
+
+    void await_suspend(std::coroutine_handle<> handle) {
+      client_.send_async(request_, [this, handle](Response&& response) {
+        response_ = std::move(response);
+        if (client_.executor) {
+          client_.executor([handle]() { handle.resume(); });
+        } else {
+          handle.resume();
+        }
+      });
+    }
+
+    Response await_resume() {
+      return std::move(response_);
+    }
+
+  private:
+    Client& client_;
+    Request request_;
+    Response response_;
+  };
+
+  // co_await client.send(request)
+  SendOperation send(const Request& request) {
+    return SendOperation{*this, request};
+  }
+#endif
+
+  // Runs the event loop on the calling thread until `stop` is called.
+  void run() {
+    while (!stopped_.exchange(false)) {
+      poll(std::chrono::seconds{1});
+    }
+  }
+
+  // Runs a single iteration of the event loop, waiting at most for the given
+  // timeout if there is nothing to do. Returns the number of transfers that
+  // are still in flight.
+  size_t poll(const std::chrono::milliseconds timeout) {
+    admit();
+
+    int running_handles = 0;
+    dispatcher_.multi().perform(running_handles);
+    dispatcher_.complete();
+
+    if (!stopped_ && !has_queued() && !can_admit()) {
+      dispatcher_.multi().poll(timeout);
+    }
+
+    return dispatcher_.active();
+  }
+
+  // Returns a response that is no longer needed, so that a later request can
+  // reuse its buffers rather than growing new ones from scratch.
+  void recycle(Response&& response) {
+    dispatcher_.recycle(std::move(response));
+  }
+
+  void stop() {
+    stopped_ = true;
+    dispatcher_.multi().wakeup();
+  }
+
+  Callbacks callbacks;
+  Context context;
+  Options options;
+  Proxy proxy;
+
+  // Resumes coroutines on the event loop thread if not set.
+  Executor executor;
+
+  // Maximum number of transfers in flight, 0 means no limit
+  size_t max_transfers = 0;
+
+private:
+  void admit() {
+    std::vector<detail::curl::Submission> queue;
+    {
+      std::lock_guard lock{mutex_};
+      queue.swap(queue_);
+    }
+    for (auto& submission : queue) {
+      const auto priority = submission.request.priority();
+      pending_[static_cast<size_t>(priority)].push_back(std::move(submission));
+    }
+
+    while (can_admit()) {
+      for (auto it = pending_.rbegin(); it != pending_.rend(); ++it) {
+        if (!it->empty()) {
+          dispatcher_.add(std::move(it->front()));
+          it->pop_front();
+          break;
+        }
+      }
+    }
+  }
+
+  bool can_admit() const {
+    const auto has_pending = std::any_of(
+        pending_.begin(), pending_.end(),
+        [](const auto& submissions) { return !submissions.empty(); });
+    return has_pending &&
+           (!max_transfers || dispatcher_.active() < max_transfers);
+  }
+
+  bool has_queued() {
+    std::lock_guard lock{mutex_};
+    return !queue_.empty();
+  }
+
+  detail::curl::Dispatcher dispatcher_;
+  std::mutex mutex_;
+  std::vector<detail::curl::Submission> queue_;
+  // Waiting for a free slot, indexed by priority
+  std::array<std::deque<detail::curl::Submission>, 3> pending_;
+  std::atomic<bool> stopped_{false};
+};
+
+}  // namespace hypr
@@ -0,0 +1,201 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <hypp/method.hpp>
+
+#include <hypr/models.hpp>
+#include <hypr/transport.hpp>
+
+namespace hypr {
+
+// Lets identical requests that are in flight at the same time share a single
+// transfer (also known as singleflight). The first caller sends the request,
+// while the others wait for its response and receive a copy of it.
+//
+// Requests are identical if they have the same method, URL and values for the
+// given headers. Only GET and HEAD requests without a body are coalesced.
+class Coalescer {
+public:
+  Coalescer()
+      : Coalescer{{"Accept", "Accept-Encoding", "Accept-Language",
+                   "Authorization", "Cookie", "Range"}} {}
+  explicit Coalescer(std::vector<std::string> headers)
+      : headers_{std::move(headers)} {}
+
+  // Calls `send`, unless an identical request is already in flight.
+  template <typename Function>
+  Response send(const Request& request, const Context& context,
+                Function&& send) {
+    if (!is_coalescable(request)) {
+      return send();
+    }
+
+    const auto key = make_key(request);
+
+    std::shared_ptr<Flight> flight;
+    bool leader = false;
+    {
+      std::lock_guard lock{mutex_};
+      auto& current = flights_[key];
+      if (!current) {
+        current = std::make_shared<Flight>();
+        leader = true;
+      }
+      flight = current;
+      if (!leader) {
+        ++waiting_;
+      }
+    }
+
+    if (leader) {
+      return lead(key, *flight, context, send);
+    }
+
+    auto response = follow(*flight, context);
+    {
+      std::lock_guard lock{mutex_};
+      --waiting_;
+    }
+
+    // The leader may have given up on its own, which is not our problem
+    if (response) {
+      return std::move(*response);
+    }
+    return send();
+  }
+
+  // Number of distinct requests that are currently in flight
+  size_t size() const {
+    std::lock_guard lock{mutex_};
+    return flights_.size();
+  }
+
+  // Number of callers that are waiting for the response to another's request
+  size_t waiting() const {
+    std::lock_guard lock{mutex_};
+    return waiting_;
+  }
+
+private:
+  struct Flight {
+    Flight() : future{promise.get_future().share()} {}
+
+    std::promise<std::optional<Response>> promise;
+    std::shared_future<std::optional<Response>> future;
+  };
+
+  template <typename Function>
+  Response lead(const std::string& key, Flight& flight, const Context& context,
+                Function& send) {
+    // Waiters must never be left behind, even if `send` throws
+    struct Landing {
+      ~Landing() {
+        {
+          std::lock_guard lock{coalescer.mutex_};
+          coalescer.flights_.erase(key);
+        }
+        flight.promise.set_value(std::move(response));
+      }
+      Coalescer& coalescer;
+      const std::string& key;
+      Flight& flight;
+      std::optional<Response> response;
+    } landing{*this, key, flight, std::nullopt};
+
+    auto response = send();
+
+    // Waiters should not be cancelled along with the leader
+    if (!context.cancelled() ||
+        response.error().code != CURLE_ABORTED_BY_CALLBACK) {
+      landing.response = response;
+    }
+
+    return response;
+  }
+
+  static std::optional<Response> follow(const Flight& flight,
+                                        const Context& context) {
+    constexpr auto interval = std::chrono::milliseconds{100};
+
+    while (true) {
+      if (context.cancelled()) {
+        return Response(CURLE_ABORTED_BY_CALLBACK);
+      }
+      if (context.expired()) {
+        return Response(CURLE_OPERATION_TIMEDOUT);
+      }
+      auto timeout = interval;
+      if (const auto remaining = context.remaining()) {
+        timeout = std::min(timeout, *remaining);
+      }
+      if (flight.future.wait_for(timeout) == std::future_status::ready) {
+        return flight.future.get();
+      }
+    }
+  }
+
+  static bool is_coalescable(const Request& request) {
+    const auto method = request.method();
+    return (method == hypp::method::kGet || method == hypp::method::kHead) &&
+           request.body().empty() && request.multipart().empty();
+  }
+
+  std::string make_key(const Request& request) const {
+    auto key = request.method();
+    key.push_back(' ');
+    key.append(hypp::to_string(request.target()));
+    for (const auto& name : headers_) {
+      key.push_back('\n');
+      key.append(request.header(name));
+    }
+    return key;
+  }
+
+  const std::vector<std::string> headers_;
+
+  mutable std::mutex mutex_;
+  std::unordered_map<std::string, std::shared_ptr<Flight>> flights_;
+  size_t waiting_ = 0;
+};
+
+// Sends requests through another transport, coalescing them with identical
+// requests of every other transport that shares the same coalescer. Streamed
+// responses are never coalesced, as their body is not kept.
+class CoalescingTransport : public Transport {
+public:
+  explicit CoalescingTransport(
+      std::shared_ptr<Coalescer> coalescer,
+      std::shared_ptr<Transport> transport = std::make_shared<CurlTransport>())
+      : coalescer_{std::move(coalescer)}, transport_{std::move(transport)} {}
+
+  Response send(const Request& request,
+                const Callbacks& callbacks,
+                const Options& options,
+                const Proxy& proxy,
+                const Context& context) override {
+    const auto send = [&]() {
+      return transport_->send(request, callbacks, options, proxy, context);
+    };
+    if (callbacks.write) {
+      return send();
+    }
+    return coalescer_->send(request, context, send);
+  }
+
+private:
+  std::shared_ptr<Coalescer> coalescer_;
+  std::shared_ptr<Transport> transport_;
+};
+
+}  // namespace hypr
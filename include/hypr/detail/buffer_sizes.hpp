@@ -0,0 +1,137 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <curl/curl.h>
+
+#include <hypr/detail/curl_session.hpp>
+
+namespace hypr::detail {
+
+// Picks receive and upload buffer sizes per host from the throughput of
+// earlier transfers. libcurl's defaults suit small responses, but fast links
+// spend most of their time in callbacks and system calls with them. Buffers
+// are sized to hold about a millisecond worth of data.
+class BufferSizes {
+public:
+  static constexpr long kMinDownload = CURL_MAX_WRITE_SIZE;  // 16 KiB
+  static constexpr long kMaxDownload =
+      std::min<long>(CURL_MAX_READ_SIZE, 2 * 1024 * 1024);
+  static constexpr long kMinUpload = 64 * 1024;
+  static constexpr long kMaxUpload = 2 * 1024 * 1024;
+
+  struct Sizes {
+    long download = kMinDownload;
+    long upload = kMinUpload;
+  };
+
+  static BufferSizes& instance() {
+    static BufferSizes buffer_sizes;
+    return buffer_sizes;
+  }
+
+  Sizes get(const std::string& host) {
+    std::lock_guard lock{mutex_};
+    const auto it = hosts_.find(host);
+    return it != hosts_.end() ? it->second.sizes : Sizes{};
+  }
+
+  void update(const std::string& host, const curl::Session& session) {
+    const auto get = [&session](const CURLINFO info) {
+      curl_off_t value = 0;
+      session.getinfo(info, value);
+      return value;
+    };
+    update(host, {get(CURLINFO_SIZE_DOWNLOAD_T),
+                  get(CURLINFO_SPEED_DOWNLOAD_T)},
+           {get(CURLINFO_SIZE_UPLOAD_T), get(CURLINFO_SPEED_UPLOAD_T)});
+  }
+
+  struct Sample {
+    curl_off_t size = 0;  // bytes
+    curl_off_t speed = 0;  // bytes per second
+  };
+
+  void update(const std::string& host, const Sample download,
+              const Sample upload) {
+    if (download.size < kMinSample && upload.size < kMinSample) {
+      return;
+    }
+
+    std::lock_guard lock{mutex_};
+    auto it = hosts_.find(host);
+    if (it == hosts_.end()) {
+      if (hosts_.size() >= kMaxHosts) {
+        evict();
+      }
+      it = hosts_.emplace(host, Throughput{}).first;
+    }
+    auto& throughput = it->second;
+    throughput.used = ++clock_;
+
+    if (download.size >= kMinSample) {
+      throughput.download = average(throughput.download, download.speed);
+      throughput.sizes.download =
+          to_size(throughput.download, kMinDownload, kMaxDownload);
+    }
+    if (upload.size >= kMinSample) {
+      throughput.upload = average(throughput.upload, upload.speed);
+      throughput.sizes.upload =
+          to_size(throughput.upload, kMinUpload, kMaxUpload);
+    }
+  }
+
+  size_t size() {
+    std::lock_guard lock{mutex_};
+    return hosts_.size();
+  }
+
+  static double average(const double previous, const curl_off_t speed) {
+    constexpr double weight = 0.3;
+    return previous > 0 ? previous + weight * (speed - previous) : speed;
+  }
+
+  // Smallest power of two times `min` that holds a millisecond worth of data
+  static long to_size(const double speed, const long min, const long max) {
+    const auto target = static_cast<long>(speed / 1000);
+    auto size = min;
+    while (size < target && size < max) {
+      size *= 2;
+    }
+    return std::min(size, max);
+  }
+
+  // Smaller transfers are dominated by latency rather than bandwidth
+  static constexpr curl_off_t kMinSample = 256 * 1024;
+
+  // Hosts that were not seen for the longest time are forgotten first
+  static constexpr size_t kMaxHosts = 256;
+
+private:
+  struct Throughput {
+    double download = 0;  // bytes per second
+    double upload = 0;
+    Sizes sizes;
+    uint64_t used = 0;
+  };
+
+  void evict() {
+    const auto it = std::min_element(
+        hosts_.begin(), hosts_.end(), [](const auto& a, const auto& b) {
+          return a.second.used < b.second.used;
+        });
+    if (it != hosts_.end()) {
+      hosts_.erase(it);
+    }
+  }
+
+  std::mutex mutex_;
+  std::unordered_map<std::string, Throughput> hosts_;
+  uint64_t clock_ = 0;
+};
+
+}  // namespace hypr::detail
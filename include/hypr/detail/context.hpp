@@ -0,0 +1,95 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <optional>
+
+namespace hypr::detail {
+
+class CancellationToken {
+public:
+  CancellationToken() : state_{std::make_shared<State>()} {}
+
+  // Can be called from any thread. In-flight transfers are aborted from their
+  // progress callback, which libcurl calls frequently during a transfer.
+  void cancel() const {
+    state_->cancelled.store(true, std::memory_order_release);
+  }
+
+  bool cancelled() const {
+    for (const State* state = state_.get(); state; state = state->parent.get()) {
+      if (state->cancelled.load(std::memory_order_acquire)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Returns a token that is cancelled along with this one, but can also be
+  // cancelled on its own without affecting this one.
+  CancellationToken child() const {
+    CancellationToken token;
+    token.state_->parent = state_;
+    return token;
+  }
+
+private:
+  struct State {
+    std::atomic<bool> cancelled{false};
+    std::shared_ptr<const State> parent;
+  };
+
+  std::shared_ptr<State> state_;
+};
+
+class Context {
+public:
+  using clock_t = std::chrono::steady_clock;
+
+  Context() = default;
+  Context(const std::chrono::milliseconds timeout)
+      : deadline{clock_t::now() + timeout} {}
+  Context(const clock_t::time_point deadline) : deadline{deadline} {}
+
+  // Derives a context that expires no later than this one, and is cancelled
+  // whenever this one is.
+  Context child() const {
+    Context context;
+    context.deadline = deadline;
+    context.cancellation = cancellation.child();
+    return context;
+  }
+  Context child(const std::chrono::milliseconds timeout) const {
+    auto context = child();
+    const auto child_deadline = clock_t::now() + timeout;
+    context.deadline = deadline ? std::min(*deadline, child_deadline)
+                                : child_deadline;
+    return context;
+  }
+
+  bool cancelled() const {
+    return cancellation.cancelled();
+  }
+
+  bool expired() const {
+    return deadline && clock_t::now() >= *deadline;
+  }
+
+  // Time left until the deadline, or nullopt if there is no deadline.
+  std::optional<std::chrono::milliseconds> remaining() const {
+    if (!deadline) {
+      return std::nullopt;
+    }
+    const auto duration = *deadline - clock_t::now();
+    return std::max(
+        std::chrono::ceil<std::chrono::milliseconds>(duration),
+        std::chrono::milliseconds{0});
+  }
+
+  std::optional<clock_t::time_point> deadline;
+  CancellationToken cancellation;
+};
+
+}  // namespace hypr::detail
@@ -7,6 +7,7 @@
 #include <hypp/parser/header.hpp>
 #include <hypp/parser/response.hpp>
 
+#include <hypr/detail/memory_budget.hpp>
 #include <hypr/detail/models.hpp>
 
 namespace hypr::detail::curl {
@@ -47,7 +48,9 @@ inline size_t header_callback(char* buffer, size_t size, size_t nitems,
       response.header_fields.emplace_back(std::move(expected.value()));
 
     } else if (line == hypp::detail::syntax::kCRLF) {
-      if (response.body.empty() && response.session) {
+      // Memory would be allocated ahead of the budget
+      if (response.body.empty() && response.session &&
+          !response.callbacks.write && !MemoryBudget::instance().limited()) {
         curl_off_t content_length = 0;
         const auto curl_code = response.session->getinfo(
             CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, content_length);
@@ -64,14 +67,37 @@ inline size_t header_callback(char* buffer, size_t size, size_t nitems,
   return line.size();
 }
 
+inline size_t mime_read_callback(char* buffer, size_t size, size_t nitems,
+                                 void* arg) {
+  if (arg) {
+    const auto& part = *static_cast<const hypr::detail::MimePart*>(arg);
+    if (part.reader) {
+      return part.reader(buffer, size * nitems);
+    }
+  }
+
+  return 0;
+}
+
 inline int progress_callback(void* clientp,
                              curl_off_t dltotal, curl_off_t dlnow,
                              curl_off_t, curl_off_t) {
-  if (clientp && (dltotal || dlnow)) {
+  if (clientp) {
     auto& response = *static_cast<hypr::detail::Response*>(clientp);
 
-    if (response.transfer.current != dlnow ||
-        response.transfer.total != dltotal) {
+    if (response.context.cancelled()) {
+      return 1;  // abort
+    }
+
+    if (response.memory.paused() && MemoryBudget::instance().has_room() &&
+        response.session) {
+      response.memory.resume();
+      // Data that was refused before is delivered again from here
+      curl_easy_pause(response.session->get(), CURLPAUSE_CONT);
+    }
+
+    if ((dltotal || dlnow) && (response.transfer.current != dlnow ||
+                               response.transfer.total != dltotal)) {
       response.transfer = {dlnow, dltotal};
       if (response.callbacks.transfer) {
         if (!response.callbacks.transfer(response.transfer)) {
@@ -90,7 +116,21 @@ inline size_t write_callback(char* ptr, size_t size, size_t nmemb,
 
   if (userdata && !data.empty()) {
     auto& response = *static_cast<hypr::detail::Response*>(userdata);
-    response.body.append(data);
+    if (response.callbacks.write) {
+      if (!response.callbacks.write(data)) {
+        return 0;  // abort
+      }
+    } else {
+      // Resumed by the progress callback once there is room
+      if (!response.memory.add(data.size())) {
+        response.memory.pause();
+        return CURL_WRITEFUNC_PAUSE;
+      }
+      response.body.append(data);
+    }
+    if (response.digester) {
+      response.digester->update(data);
+    }
   }
 
   return data.size();
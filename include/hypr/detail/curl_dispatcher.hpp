@@ -0,0 +1,178 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <curl/curl.h>
+
+#include <hypr/detail/curl_interface.hpp>
+#include <hypr/detail/curl_multi.hpp>
+#include <hypr/detail/curl_session.hpp>
+#include <hypr/detail/curl_share.hpp>
+#include <hypr/detail/models.hpp>
+#include <hypr/models.hpp>
+
+namespace hypr::detail::curl {
+
+// A request waiting to be added to a dispatcher, along with the settings it
+// was submitted with.
+struct Submission {
+  hypr::Request request;
+  hypr::Callbacks callbacks;
+  hypr::Options options;
+  hypr::Proxy proxy;
+  hypr::Context context;
+  std::function<void(hypr::Response&&)> callback;
+};
+
+// Keeps track of the transfers that are running on a multi handle. It does
+// not drive the multi handle itself; that is left to its owner, which calls
+// `complete` whenever libcurl might have finished some transfers.
+class Dispatcher {
+public:
+  using callback_t = std::function<void(hypr::Response&&)>;
+
+  bool init() {
+    return Interface::init() && multi_.init();
+  }
+
+  // Starts a transfer. The callback is always called exactly once, either
+  // from `complete` or right away if the transfer could not be started.
+  bool add(const hypr::Request& request,
+           const hypr::Callbacks& callbacks,
+           const hypr::Options& options,
+           const hypr::Proxy& proxy,
+           const hypr::Context& context,
+           callback_t callback) {
+    auto operation = std::make_unique<Operation>();
+    operation->request = request;
+    operation->callback = std::move(callback);
+    operation->session = acquire_session();
+    operation->response = acquire_response();
+
+    auto code = init() ? CURLE_OK : CURLE_FAILED_INIT;
+    if (code == CURLE_OK) {
+      code = Interface::prepare(operation->request, callbacks, options, proxy,
+                                context, operation->session,
+                                operation->response);
+    }
+    if (code == CURLE_OK && share_) {
+      code = operation->session.setopt(CURLOPT_SHARE, share_->get());
+    }
+    if (code == CURLE_OK &&
+        multi_.add_handle(operation->session) != CURLM_OK) {
+      code = CURLE_FAILED_INIT;
+    }
+    if (code != CURLE_OK) {
+      release_session(std::move(operation->session));
+      operation->callback(hypr::Response(code));
+      return false;
+    }
+
+    const auto handle = operation->session.get();
+    operations_.emplace(handle, std::move(operation));
+    return true;
+  }
+
+  bool add(Submission&& submission) {
+    return add(submission.request, submission.callbacks, submission.options,
+               submission.proxy, submission.context,
+               std::move(submission.callback));
+  }
+
+  // Reads finished transfers from the multi handle and calls their callbacks.
+  // Callbacks may add new transfers.
+  void complete() {
+    while (const auto message = multi_.info_read()) {
+      if (message->msg != CURLMSG_DONE) {
+        continue;
+      }
+
+      const auto it = operations_.find(message->easy_handle);
+      if (it == operations_.end()) {
+        continue;
+      }
+      auto operation = std::move(it->second);
+      operations_.erase(it);
+
+      const auto code = message->data.result;  // invalid after remove_handle
+      multi_.remove_handle(operation->session);
+
+      auto response = Interface::complete(code, operation->session,
+                                          std::move(operation->response));
+      release_session(std::move(operation->session));
+      operation->callback(std::move(response));
+    }
+  }
+
+  // Keeps a response that is no longer needed, so that a later transfer can
+  // reuse its buffers.
+  void recycle(hypr::Response&& response) {
+    if (idle_responses_.size() < kMaxIdleResponses) {
+      idle_responses_.push_back(Interface::recycle(std::move(response)));
+    }
+  }
+
+  size_t active() const {
+    return operations_.size();
+  }
+
+  const Multi& multi() const {
+    return multi_;
+  }
+
+  // Replaces the default share for transfers that are added afterwards. The
+  // share must outlive them.
+  void set_share(const Share* share) {
+    share_ = share;
+  }
+
+private:
+  struct Operation {
+    hypr::Request request;
+    hypr::detail::Response response;
+    Session session;
+    callback_t callback;
+  };
+
+  // Easy handles keep their buffers and settings between transfers, so we
+  // hold on to them rather than creating a new one for each request.
+  Session acquire_session() {
+    if (idle_sessions_.empty()) {
+      return Session{};
+    }
+    auto session = std::move(idle_sessions_.back());
+    idle_sessions_.pop_back();
+    return session;
+  }
+
+  void release_session(Session&& session) {
+    idle_sessions_.push_back(std::move(session));
+  }
+
+  hypr::detail::Response acquire_response() {
+    if (idle_responses_.empty()) {
+      return {};
+    }
+    auto response = std::move(idle_responses_.back());
+    idle_responses_.pop_back();
+    return response;
+  }
+
+  // Recycled responses hold on to memory that the budget does not know about,
+  // so there should not be too many of them.
+  static constexpr size_t kMaxIdleResponses = 64;
+
+  // Easy handles must be cleaned up before the multi handle, which is why the
+  // multi handle is declared first.
+  Multi multi_;
+  std::unordered_map<CURL*, std::unique_ptr<Operation>> operations_;
+  std::vector<Session> idle_sessions_;
+  std::vector<hypr::detail::Response> idle_responses_;
+  const Share* share_ = nullptr;
+};
+
+}  // namespace hypr::detail::curl
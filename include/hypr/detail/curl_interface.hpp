@@ -4,22 +4,28 @@
 #include <memory>
 #include <string>
 #include <string_view>
+#include <vector>
 
 #include <curl/curl.h>
 #include <hypp/generator/request.hpp>
 #include <hypp/method.hpp>
+#include <hypp/status.hpp>
 
+#include <hypr/detail/buffer_sizes.hpp>
 #include <hypr/detail/curl_callback.hpp>
 #include <hypr/detail/curl_global.hpp>
 #include <hypr/detail/curl_session.hpp>
 #include <hypr/detail/curl_share.hpp>
 #include <hypr/detail/models.hpp>
+#include <hypr/detail/trace.hpp>
 #include <hypr/models.hpp>
 
 namespace hypr::detail::curl {
 
 #define HYPR_CURL_CHECK_OK(arg) \
     if (auto code = arg; code != CURLE_OK) return hypr::Response(code)
+#define HYPR_CURL_CHECK(arg) \
+    if (auto code = arg; code != CURLE_OK) return code
 #define HYPR_CURL_SETOPT(option, arg) \
     if (auto code = session.setopt(option, arg); code != CURLE_OK) return code
 
@@ -42,25 +48,95 @@ public:
                              const hypr::Callbacks& callbacks,
                              const hypr::Options& options,
                              const hypr::Proxy& proxy,
+                             const hypr::Context& context,
                              Session& session) {
     hypr::detail::Response response;
 
+    HYPR_CURL_CHECK_OK(prepare(request, callbacks, options, proxy, context,
+                               session, response));
+
+    const auto curl_code = session.perform();  // blocks
+
+    return complete(curl_code, session, std::move(response));
+  }
+
+  // Same as `send`, but receives the response into an earlier one, so that the
+  // capacity of its buffers is reused.
+  static void send_into(const hypr::Request& request,
+                        const hypr::Callbacks& callbacks,
+                        const hypr::Options& options,
+                        const hypr::Proxy& proxy,
+                        const hypr::Context& context,
+                        Session& session,
+                        hypr::Response& response) {
+    auto& data = response.response_;
+    data.recycle();
+
+    auto code = prepare(request, callbacks, options, proxy, context, session,
+                        data);
+    if (code == CURLE_OK) {
+      code = finish(session.perform(), session, data);  // blocks
+    }
+    if (code != CURLE_OK) {
+      data.recycle();
+      data.error.code = code;
+    }
+  }
+
+  // Prepares the session for a transfer that writes into the given response.
+  // Both must stay at the same address until the transfer is complete. The
+  // request body is not copied, so it must outlive the transfer as well.
+  static CURLcode prepare(const hypr::Request& request,
+                          const hypr::Callbacks& callbacks,
+                          const hypr::Options& options,
+                          const hypr::Proxy& proxy,
+                          const hypr::Context& context,
+                          Session& session,
+                          hypr::detail::Response& response) {
     response.callbacks = callbacks;
+    response.context = context;
     response.session = &session;
+    // Responses to HEAD requests have no body to verify
+    if (options.digest != DigestAlgorithm::None &&
+        request.method() != hypp::method::kHead) {
+      response.digester.emplace(options.digest);
+      response.expected_digest = options.expected_digest;
+    }
 
-    HYPR_CURL_CHECK_OK(init() ? CURLE_OK : CURLE_FAILED_INIT);
-    HYPR_CURL_CHECK_OK(session.init() ? CURLE_OK : CURLE_FAILED_INIT);
-    HYPR_CURL_CHECK_OK(prepare_session(response, session));
-    HYPR_CURL_CHECK_OK(prepare_session(options, session));
-    HYPR_CURL_CHECK_OK(prepare_session(proxy, session));
-    HYPR_CURL_CHECK_OK(prepare_session(request, session));
-    HYPR_CURL_CHECK_OK(session.perform());  // blocks
+    HYPR_CURL_CHECK(init() ? CURLE_OK : CURLE_FAILED_INIT);
+    HYPR_CURL_CHECK(session.init() ? CURLE_OK : CURLE_FAILED_INIT);
+    HYPR_CURL_CHECK(prepare_session(response, session));
+    HYPR_CURL_CHECK(prepare_session(options, session));
+    HYPR_CURL_CHECK(prepare_session(context, options, session));
+    HYPR_CURL_CHECK(prepare_session(proxy, session));
+    HYPR_CURL_CHECK(prepare_session(request, session));
+    HYPR_CURL_CHECK(prepare_buffers(request, options, session, response));
 
-    prepare_response(session, response);
+    return CURLE_OK;
+  }
+
+  // Builds the final response once the transfer is done. Failed responses
+  // are cleared, but keep their buffers for whoever recycles them next.
+  static hypr::Response complete(const CURLcode curl_code,
+                                 const Session& session,
+                                 hypr::detail::Response&& response) {
+    if (const auto code = finish(curl_code, session, response);
+        code != CURLE_OK) {
+      response.recycle();
+      response.error.code = code;
+    }
 
     return hypr::Response(std::move(response));
   }
 
+  // Returns a response that is no longer needed, so that a later transfer can
+  // reuse its buffers.
+  static hypr::detail::Response recycle(hypr::Response&& response) {
+    auto data = std::move(response.response_);
+    data.recycle();
+    return data;
+  }
+
 private:
   static std::string get_default_user_agent() {
     static const auto default_user_agent = std::string{"hypr/0.1 libcurl/"} +
@@ -70,6 +146,23 @@ private:
     return default_user_agent;
   }
 
+  static CURLcode finish(const CURLcode curl_code,
+                         const Session& session,
+                         hypr::detail::Response& response) {
+    trace::record(session, curl_code);
+    response.memory.finish();
+
+    HYPR_CURL_CHECK(curl_code);
+
+    if (response.buffer_host) {
+      BufferSizes::instance().update(*response.buffer_host, session);
+    }
+
+    prepare_response(session, response);
+
+    return verify_digest(response);
+  }
+
   static CURLcode prepare_session(const hypr::detail::Response& response,
                                   Session& session) {
     // Behavior options
@@ -95,10 +188,6 @@ private:
 #endif
     HYPR_CURL_SETOPT(CURLOPT_USERAGENT, get_default_user_agent().c_str());
     HYPR_CURL_SETOPT(CURLOPT_COOKIEFILE, "");
-    HYPR_CURL_SETOPT(CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_1_1);
-
-    // Connection options
-    HYPR_CURL_SETOPT(CURLOPT_LOW_SPEED_LIMIT, 1024L);
 
     // Other options
     if (cache_) {
@@ -113,10 +202,29 @@ private:
     HYPR_CURL_SETOPT(CURLOPT_FOLLOWLOCATION, options.allow_redirects);
     HYPR_CURL_SETOPT(CURLOPT_MAXREDIRS,
         std::max(static_cast<long>(options.max_redirects), -1L));
+    HYPR_CURL_SETOPT(CURLOPT_HTTP_VERSION,
+        options.http2 ? CURL_HTTP_VERSION_2TLS : CURL_HTTP_VERSION_1_1);
+    HYPR_CURL_SETOPT(CURLOPT_LOW_SPEED_LIMIT,
+        std::max(static_cast<long>(options.low_speed_limit), 0L));
     HYPR_CURL_SETOPT(CURLOPT_LOW_SPEED_TIME,
         std::max(static_cast<long>(options.timeout.count()), 0L));
     HYPR_CURL_SETOPT(CURLOPT_CONNECTTIMEOUT,
         std::max(static_cast<long>(options.timeout.count()), 0L));
+    const auto unix_socket =
+        !options.unix_socket.empty() ? options.unix_socket.c_str() : nullptr;
+    HYPR_CURL_SETOPT(options.abstract_unix_socket
+                         ? CURLOPT_ABSTRACT_UNIX_SOCKET
+                         : CURLOPT_UNIX_SOCKET_PATH,
+                     unix_socket);
+    HYPR_CURL_SETOPT(CURLOPT_MAXCONNECTS,
+        static_cast<long>(options.max_connections));
+    HYPR_CURL_SETOPT(CURLOPT_TCP_NODELAY, options.tcp_nodelay);
+    HYPR_CURL_SETOPT(CURLOPT_TCP_KEEPALIVE, options.tcp_keepalive);
+    HYPR_CURL_SETOPT(CURLOPT_TCP_KEEPIDLE,
+        std::max(static_cast<long>(options.tcp_keepalive_idle.count()), 1L));
+    HYPR_CURL_SETOPT(CURLOPT_TCP_KEEPINTVL,
+        std::max(static_cast<long>(options.tcp_keepalive_interval.count()),
+                 1L));
     HYPR_CURL_SETOPT(CURLOPT_VERBOSE, options.verbose);
     HYPR_CURL_SETOPT(CURLOPT_SSL_VERIFYHOST,
         options.verify_certificate ? 2L : 0L);
@@ -128,6 +236,59 @@ private:
     return CURLE_OK;
   }
 
+  static CURLcode prepare_session(const hypr::Context& context,
+                                  const hypr::Options& options,
+                                  Session& session) {
+    if (context.cancelled()) {
+      return CURLE_ABORTED_BY_CALLBACK;
+    }
+
+    // The total timeout is the tighter of our own limit and the deadline that
+    // was propagated from the parent context.
+    auto timeout = options.total_timeout;
+    if (const auto remaining = context.remaining()) {
+      if (remaining->count() == 0) {
+        return CURLE_OPERATION_TIMEDOUT;
+      }
+      timeout = timeout.count() > 0 ? std::min(timeout, *remaining)
+                                    : *remaining;
+    }
+    HYPR_CURL_SETOPT(CURLOPT_TIMEOUT_MS,
+        std::max(static_cast<long>(timeout.count()), 0L));
+
+    return CURLE_OK;
+  }
+
+  // Explicit sizes take precedence over adaptive ones. Values are clamped to
+  // the limits of libcurl.
+  static CURLcode prepare_buffers(const hypr::Request& request,
+                                  const hypr::Options& options,
+                                  Session& session,
+                                  hypr::detail::Response& response) {
+    BufferSizes::Sizes sizes;
+
+    if (options.adaptive_buffers) {
+      const auto& authority = request.target().uri.authority;
+      response.buffer_host = authority ? authority->host : std::string{};
+      sizes = BufferSizes::instance().get(*response.buffer_host);
+    }
+    if (options.buffer_size) {
+      sizes.download = static_cast<long>(
+          std::min<size_t>(options.buffer_size, CURL_MAX_READ_SIZE));
+    }
+    if (options.upload_buffer_size) {
+      sizes.upload = static_cast<long>(std::min<size_t>(
+          options.upload_buffer_size, BufferSizes::kMaxUpload));
+    }
+
+    // Sizes are only a hint. Some versions of libcurl refuse to change them
+    // while a buffer from a previous transfer is still allocated.
+    session.setopt(CURLOPT_BUFFERSIZE, sizes.download);
+    session.setopt(CURLOPT_UPLOAD_BUFFERSIZE, sizes.upload);
+
+    return CURLE_OK;
+  }
+
   static CURLcode prepare_session(const hypr::Proxy& proxy, Session& session) {
     const auto get_value = [](const std::string& value) {
       return !value.empty() ? value.c_str() : nullptr;
@@ -168,10 +329,127 @@ private:
 
     // CURLOPT_POSTFIELDS automatically sets the request to HTTPREQ_POST, so
     // we need to set the correct behavior afterwards.
-    if (!request.body().empty() || request.method() == hypp::method::kPost) {
-      HYPR_CURL_SETOPT(CURLOPT_POST, 1L);
+    if (!request.multipart().empty()) {
+      HYPR_CURL_CHECK(prepare_mime(request.multipart(), session));
     } else {
-      HYPR_CURL_SETOPT(CURLOPT_HTTPGET, 1L);
+      if (session.mime.get()) {
+        HYPR_CURL_SETOPT(CURLOPT_MIMEPOST, static_cast<curl_mime*>(nullptr));
+        session.mime.free();
+      }
+      if (!request.body().empty() || request.method() == hypp::method::kPost) {
+        HYPR_CURL_SETOPT(CURLOPT_POST, 1L);
+      } else {
+        HYPR_CURL_SETOPT(CURLOPT_HTTPGET, 1L);
+      }
+    }
+
+    // Priority
+    //
+    // Only has an effect on multiplexed HTTP/2 connections, where the server
+    // is asked to share bandwidth between streams in proportion to weights.
+    // Fails if libcurl is built without HTTP/2 support, which is fine.
+    session.setopt(CURLOPT_STREAM_WEIGHT,
+                   get_stream_weight(request.priority()));
+
+    // Otherwise libcurl waits for a body that will never arrive. Setting the
+    // request behavior above resets this option for other methods.
+    if (request.method() == hypp::method::kHead) {
+      HYPR_CURL_SETOPT(CURLOPT_NOBODY, 1L);
+    }
+
+    return CURLE_OK;
+  }
+
+  // Parts are streamed from their source while the request is being sent,
+  // rather than the whole form being built in memory beforehand.
+  static CURLcode prepare_mime(const std::vector<MimePart>& parts,
+                               Session& session) {
+    Mime mime;
+    if (!mime.init(session.get())) {
+      return CURLE_OUT_OF_MEMORY;
+    }
+
+    for (const auto& part : parts) {
+      const auto mime_part = mime.addpart();
+      if (!mime_part) {
+        return CURLE_OUT_OF_MEMORY;
+      }
+
+      HYPR_CURL_CHECK(curl_mime_name(mime_part, part.name.c_str()));
+
+      if (part.reader) {
+        const auto size = part.size ? static_cast<curl_off_t>(*part.size)
+                                    : static_cast<curl_off_t>(-1);
+        HYPR_CURL_CHECK(curl_mime_data_cb(mime_part, size, mime_read_callback,
+                                          nullptr, nullptr,
+                                          const_cast<MimePart*>(&part)));
+      } else if (!part.path.empty()) {
+        HYPR_CURL_CHECK(curl_mime_filedata(mime_part, part.path.c_str()));
+      } else {
+        HYPR_CURL_CHECK(curl_mime_data(mime_part, part.data.data(),
+                                       part.data.size()));
+      }
+
+      if (!part.filename.empty()) {
+        HYPR_CURL_CHECK(curl_mime_filename(mime_part, part.filename.c_str()));
+      }
+      if (!part.media_type.empty()) {
+        HYPR_CURL_CHECK(curl_mime_type(mime_part, part.media_type.c_str()));
+      }
+    }
+
+    // The previous form must stay alive until it is replaced
+    HYPR_CURL_SETOPT(CURLOPT_MIMEPOST, mime.get());
+    session.mime = std::move(mime);
+
+    return CURLE_OK;
+  }
+
+  static long get_stream_weight(const Priority priority) {
+    switch (priority) {
+      case Priority::Low: return 1;
+      case Priority::Normal: return 16;  // default
+      case Priority::High: return 256;
+    }
+    return 16;
+  }
+
+  static CURLcode verify_digest(hypr::detail::Response& response) {
+    if (!response.digester) {
+      return CURLE_OK;
+    }
+
+    const auto bytes = response.digester->bytes();
+    response.digest = to_hex(bytes);
+
+    // Only a part of the content, which is verified as a whole by the caller,
+    // or no content at all
+    switch (response.start_line.code) {
+      case hypp::status::k204_No_Content:
+      case hypp::status::k206_Partial_Content:
+      case hypp::status::k304_Not_Modified:
+        return CURLE_OK;
+    }
+
+    if (!response.expected_digest.empty()) {
+      return equals_case_insensitive(response.expected_digest, response.digest)
+                 ? CURLE_OK
+                 : CURLE_BAD_CONTENT_ENCODING;
+    }
+
+    // Digests of error responses describe something else
+    if (response.start_line.code != hypp::status::k200_OK) {
+      return CURLE_OK;
+    }
+    for (const auto name : {"Repr-Digest", "Digest", "X-Goog-Hash"}) {
+      const auto it = response.headers.find(name);
+      if (it == response.headers.end()) {
+        continue;
+      }
+      if (const auto expected =
+              find_digest(it->second, response.digester->name())) {
+        return *expected == bytes ? CURLE_OK : CURLE_BAD_CONTENT_ENCODING;
+      }
     }
 
     return CURLE_OK;
@@ -180,7 +458,8 @@ private:
   static void prepare_response(const Session& session,
                                hypr::detail::Response& response) {
     for (auto&& [name, value] : response.header_fields) {
-      response.headers.emplace(std::move(name), std::move(value));
+      response.spare_headers.emplace(response.headers, std::move(name),
+                                     std::move(value));
     }
     response.header_fields.clear();
 
@@ -207,6 +486,7 @@ private:
   static inline std::unique_ptr<Share> cache_;
 };
 
+#undef HYPR_CURL_CHECK
 #undef HYPR_CURL_CHECK_OK
 #undef HYPR_CURL_SETOPT
 
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <memory>
+
+#include <curl/curl.h>
+
+namespace hypr::detail::curl {
+
+class Mime {
+public:
+  // https://curl.haxx.se/libcurl/c/curl_mime_init.html
+  bool init(CURL* handle) {
+    mime_.reset(curl_mime_init(handle));
+    return mime_ != nullptr;
+  }
+
+  // https://curl.haxx.se/libcurl/c/curl_mime_free.html
+  void free() {
+    mime_.reset();
+  }
+
+  // https://curl.haxx.se/libcurl/c/curl_mime_addpart.html
+  curl_mimepart* addpart() const {
+    return curl_mime_addpart(mime_.get());
+  }
+
+  curl_mime* get() const {
+    return mime_.get();
+  }
+
+private:
+  struct Deleter {
+    void operator()(curl_mime* p) const {
+      curl_mime_free(p);
+    }
+  };
+
+  std::unique_ptr<curl_mime, Deleter> mime_;
+};
+
+}  // namespace hypr::detail::curl
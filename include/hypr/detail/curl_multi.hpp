@@ -0,0 +1,91 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+
+#include <curl/curl.h>
+
+#include <hypr/detail/curl_session.hpp>
+
+namespace hypr::detail::curl {
+
+class Multi {
+public:
+  // https://curl.haxx.se/libcurl/c/curl_multi_init.html
+  bool init() {
+    if (!handle_) {
+      handle_.reset(curl_multi_init());
+    }
+    return handle_ != nullptr;
+  }
+
+  // https://curl.haxx.se/libcurl/c/curl_multi_cleanup.html
+  void cleanup() {
+    handle_.reset();
+  }
+
+  // https://curl.haxx.se/libcurl/c/curl_multi_setopt.html
+  template <typename T>
+  CURLMcode setopt(CURLMoption option, const T& arg) const {
+    return curl_multi_setopt(handle_.get(), option, arg);
+  }
+
+  // https://curl.haxx.se/libcurl/c/curl_multi_add_handle.html
+  CURLMcode add_handle(const Session& session) const {
+    return curl_multi_add_handle(handle_.get(), session.get());
+  }
+
+  // https://curl.haxx.se/libcurl/c/curl_multi_remove_handle.html
+  CURLMcode remove_handle(const Session& session) const {
+    return curl_multi_remove_handle(handle_.get(), session.get());
+  }
+
+  // https://curl.haxx.se/libcurl/c/curl_multi_perform.html
+  CURLMcode perform(int& running_handles) const {
+    return curl_multi_perform(handle_.get(), &running_handles);
+  }
+
+  // https://curl.haxx.se/libcurl/c/curl_multi_poll.html
+  CURLMcode poll(const std::chrono::milliseconds timeout) const {
+    return curl_multi_poll(handle_.get(), nullptr, 0,
+                           static_cast<int>(timeout.count()), nullptr);
+  }
+
+  // https://curl.haxx.se/libcurl/c/curl_multi_wakeup.html
+  CURLMcode wakeup() const {
+    return curl_multi_wakeup(handle_.get());
+  }
+
+  // https://curl.haxx.se/libcurl/c/curl_multi_info_read.html
+  CURLMsg* info_read() const {
+    int msgs_in_queue = 0;
+    return curl_multi_info_read(handle_.get(), &msgs_in_queue);
+  }
+
+  // https://curl.haxx.se/libcurl/c/curl_multi_socket_action.html
+  CURLMcode socket_action(curl_socket_t socket, int ev_bitmask,
+                          int& running_handles) const {
+    return curl_multi_socket_action(handle_.get(), socket, ev_bitmask,
+                                    &running_handles);
+  }
+
+  // https://curl.haxx.se/libcurl/c/curl_multi_assign.html
+  CURLMcode assign(curl_socket_t socket, void* socketp) const {
+    return curl_multi_assign(handle_.get(), socket, socketp);
+  }
+
+  CURLM* get() const {
+    return handle_.get();
+  }
+
+private:
+  struct Deleter {
+    void operator()(CURLM* p) const {
+      curl_multi_cleanup(p);
+    }
+  };
+
+  std::unique_ptr<CURLM, Deleter> handle_;
+};
+
+}  // namespace hypr::detail::curl
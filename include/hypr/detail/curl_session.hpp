@@ -4,6 +4,7 @@
 
 #include <curl/curl.h>
 
+#include <hypr/detail/curl_mime.hpp>
 #include <hypr/detail/curl_slist.hpp>
 
 namespace hypr::detail::curl {
@@ -45,7 +46,12 @@ public:
     curl_easy_reset(handle_.get());
   }
 
+  CURL* get() const {
+    return handle_.get();
+  }
+
   Slist header_list;
+  Mime mime;
 
 private:
   struct Deleter {
@@ -19,6 +19,9 @@ public:
     if (!share_) {
       share_.reset(curl_share_init());
       if (share_) {
+        // The lock function is called from multiple threads, so the map must
+        // not be modified afterwards.
+        locks_[CURL_LOCK_DATA_SHARE];
         (locks_[lock_data], ...);
         setopt(CURLSHOPT_LOCKFUNC, Lock);
         setopt(CURLSHOPT_UNLOCKFUNC, Unlock);
@@ -56,11 +59,15 @@ private:
   static void Lock(CURL*, curl_lock_data lock_data, curl_lock_access,
                    void* userptr) {
     auto& locks = *static_cast<locks_t*>(userptr);
-    locks[lock_data].lock();
+    if (const auto it = locks.find(lock_data); it != locks.end()) {
+      it->second.lock();
+    }
   };
   static void Unlock(CURL*, curl_lock_data lock_data, void* userptr) {
     auto& locks = *static_cast<locks_t*>(userptr);
-    locks[lock_data].unlock();
+    if (const auto it = locks.find(lock_data); it != locks.end()) {
+      it->second.unlock();
+    }
   };
 
   locks_t locks_;
@@ -0,0 +1,339 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#include <nmmintrin.h>
+#define HYPR_HAS_CRC32C_SSE42
+#endif
+
+#include <hypr/detail/util.hpp>
+
+namespace hypr::detail {
+
+enum class DigestAlgorithm {
+  None,
+  Crc32c,
+  Sha256,
+};
+
+// CRC-32C (Castagnoli), as used by iSCSI, ext4 and cloud storage services.
+// Uses the CRC32 instruction of SSE 4.2 if the processor supports it.
+class Crc32c {
+public:
+  void update(const std::string_view data) {
+#ifdef HYPR_HAS_CRC32C_SSE42
+    static const bool has_sse42 = __builtin_cpu_supports("sse4.2");
+    if (has_sse42) {
+      crc_ = update_sse42(crc_, data.data(), data.size());
+      return;
+    }
+#endif
+    for (const auto c : data) {
+      crc_ = kTable[(crc_ ^ static_cast<uint8_t>(c)) & 0xFF] ^ (crc_ >> 8);
+    }
+  }
+
+  uint32_t value() const {
+    return ~crc_;
+  }
+
+  // Big-endian, as it is sent in headers
+  std::string bytes() const {
+    const auto crc = value();
+    return {static_cast<char>(crc >> 24), static_cast<char>(crc >> 16),
+            static_cast<char>(crc >> 8), static_cast<char>(crc)};
+  }
+
+private:
+  static constexpr auto kTable = [] {
+    std::array<uint32_t, 256> table{};
+    for (uint32_t i = 0; i < 256; ++i) {
+      uint32_t crc = i;
+      for (int bit = 0; bit < 8; ++bit) {
+        crc = (crc >> 1) ^ ((crc & 1) ? 0x82F63B78 : 0);
+      }
+      table[i] = crc;
+    }
+    return table;
+  }();
+
+#ifdef HYPR_HAS_CRC32C_SSE42
+  __attribute__((target("sse4.2")))
+  static uint32_t update_sse42(uint32_t crc, const char* data, size_t size) {
+    uint64_t crc64 = crc;
+    for (; size >= sizeof(uint64_t); size -= sizeof(uint64_t)) {
+      uint64_t value;
+      std::memcpy(&value, data, sizeof(value));
+      crc64 = _mm_crc32_u64(crc64, value);
+      data += sizeof(value);
+    }
+    crc = static_cast<uint32_t>(crc64);
+    for (; size; --size) {
+      crc = _mm_crc32_u8(crc, static_cast<uint8_t>(*data++));
+    }
+    return crc;
+  }
+#endif
+
+  uint32_t crc_ = 0xFFFFFFFF;
+};
+
+// https://www.rfc-editor.org/rfc/rfc6234
+class Sha256 {
+public:
+  void update(std::string_view data) {
+    length_ += data.size();
+
+    if (buffered_) {
+      const auto size = std::min(data.size(), block_.size() - buffered_);
+      std::memcpy(block_.data() + buffered_, data.data(), size);
+      buffered_ += size;
+      data.remove_prefix(size);
+      if (buffered_ < block_.size()) {
+        return;
+      }
+      transform(block_.data());
+      buffered_ = 0;
+    }
+
+    for (; data.size() >= block_.size(); data.remove_prefix(block_.size())) {
+      transform(reinterpret_cast<const uint8_t*>(data.data()));
+    }
+
+    std::memcpy(block_.data(), data.data(), data.size());
+    buffered_ = data.size();
+  }
+
+  // Can only be called once
+  std::string bytes() {
+    const uint64_t bits = length_ * 8;
+
+    const char padding[64] = {'\x80'};
+    const auto padding_size = (buffered_ < 56 ? 56 : 120) - buffered_;
+    update(std::string_view{padding, padding_size});
+
+    char length[8];
+    for (size_t i = 0; i < sizeof(length); ++i) {
+      length[i] = static_cast<char>(bits >> (56 - i * 8));
+    }
+    update(std::string_view{length, sizeof(length)});
+
+    std::string digest;
+    for (const auto word : state_) {
+      digest.push_back(static_cast<char>(word >> 24));
+      digest.push_back(static_cast<char>(word >> 16));
+      digest.push_back(static_cast<char>(word >> 8));
+      digest.push_back(static_cast<char>(word));
+    }
+    return digest;
+  }
+
+private:
+  static constexpr uint32_t rotate(const uint32_t x, const int n) {
+    return (x >> n) | (x << (32 - n));
+  }
+
+  void transform(const uint8_t* block) {
+    static constexpr uint32_t k[64] = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b,
+        0x59f111f1, 0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01,
+        0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7,
+        0xc19bf174, 0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+        0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da, 0x983e5152,
+        0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+        0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc,
+        0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819,
+        0xd6990624, 0xf40e3585, 0x106aa070, 0x19a4c116, 0x1e376c08,
+        0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f,
+        0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+        0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+    };
+
+    uint32_t w[64];
+    for (int i = 0; i < 16; ++i) {
+      const auto bytes = block + i * 4;
+      w[i] = (uint32_t{bytes[0]} << 24) | (uint32_t{bytes[1]} << 16) |
+             (uint32_t{bytes[2]} << 8) | uint32_t{bytes[3]};
+    }
+    for (int i = 16; i < 64; ++i) {
+      const auto s0 =
+          rotate(w[i - 15], 7) ^ rotate(w[i - 15], 18) ^ (w[i - 15] >> 3);
+      const auto s1 =
+          rotate(w[i - 2], 17) ^ rotate(w[i - 2], 19) ^ (w[i - 2] >> 10);
+      w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    auto [a, b, c, d, e, f, g, h] = state_;
+    for (int i = 0; i < 64; ++i) {
+      const auto s1 = rotate(e, 6) ^ rotate(e, 11) ^ rotate(e, 25);
+      const auto ch = (e & f) ^ (~e & g);
+      const auto t1 = h + s1 + ch + k[i] + w[i];
+      const auto s0 = rotate(a, 2) ^ rotate(a, 13) ^ rotate(a, 22);
+      const auto maj = (a & b) ^ (a & c) ^ (b & c);
+      const auto t2 = s0 + maj;
+      h = g;
+      g = f;
+      f = e;
+      e = d + t1;
+      d = c;
+      c = b;
+      b = a;
+      a = t1 + t2;
+    }
+
+    state_[0] += a;
+    state_[1] += b;
+    state_[2] += c;
+    state_[3] += d;
+    state_[4] += e;
+    state_[5] += f;
+    state_[6] += g;
+    state_[7] += h;
+  }
+
+  std::array<uint32_t, 8> state_{0x6a09e667, 0xbb67ae85, 0x3c6ef372,
+                                 0xa54ff53a, 0x510e527f, 0x9b05688c,
+                                 0x1f83d9ab, 0x5be0cd19};
+  std::array<uint8_t, 64> block_{};
+  size_t buffered_ = 0;
+  uint64_t length_ = 0;
+};
+
+// Computes the digest of a response body as it is received.
+class Digester {
+public:
+  explicit Digester(const DigestAlgorithm algorithm) : algorithm_{algorithm} {}
+
+  DigestAlgorithm algorithm() const {
+    return algorithm_;
+  }
+
+  void update(const std::string_view data) {
+    switch (algorithm_) {
+      case DigestAlgorithm::None: break;
+      case DigestAlgorithm::Crc32c: crc32c_.update(data); break;
+      case DigestAlgorithm::Sha256: sha256_.update(data); break;
+    }
+  }
+
+  // Raw bytes of the digest. Can only be called once.
+  std::string bytes() {
+    switch (algorithm_) {
+      case DigestAlgorithm::None: break;
+      case DigestAlgorithm::Crc32c: return crc32c_.bytes();
+      case DigestAlgorithm::Sha256: return sha256_.bytes();
+    }
+    return {};
+  }
+
+  // Name of the algorithm in Digest and Repr-Digest headers
+  std::string_view name() const {
+    switch (algorithm_) {
+      case DigestAlgorithm::None: break;
+      case DigestAlgorithm::Crc32c: return "crc32c";
+      case DigestAlgorithm::Sha256: return "sha-256";
+    }
+    return {};
+  }
+
+private:
+  DigestAlgorithm algorithm_;
+  Crc32c crc32c_;
+  Sha256 sha256_;
+};
+
+[[nodiscard]] inline std::string to_hex(const std::string_view bytes) {
+  constexpr std::string_view digits = "0123456789abcdef";
+  std::string hex;
+  hex.reserve(bytes.size() * 2);
+  for (const auto c : bytes) {
+    hex.push_back(digits[static_cast<uint8_t>(c) >> 4]);
+    hex.push_back(digits[static_cast<uint8_t>(c) & 0x0F]);
+  }
+  return hex;
+}
+
+// Returns the digest of a file in hex, or nothing if it cannot be read.
+[[nodiscard]] inline std::optional<std::string> digest_file(
+    const std::string& path, const DigestAlgorithm algorithm) {
+  std::ifstream stream{path, std::ios::binary};
+  if (!stream.is_open()) {
+    return std::nullopt;
+  }
+  Digester digester{algorithm};
+  std::string buffer(64 * 1024, '\0');
+  while (stream.read(buffer.data(), buffer.size()) || stream.gcount()) {
+    digester.update(std::string_view{buffer.data(),
+                                     static_cast<size_t>(stream.gcount())});
+  }
+  if (stream.bad()) {
+    return std::nullopt;
+  }
+  return to_hex(digester.bytes());
+}
+
+[[nodiscard]] inline std::optional<std::string> from_base64(
+    std::string_view str) {
+  while (!str.empty() && str.back() == '=') {
+    str.remove_suffix(1);
+  }
+
+  std::string bytes;
+  uint32_t buffer = 0;
+  int bits = 0;
+  for (const auto c : str) {
+    uint32_t value = 0;
+    if ('A' <= c && c <= 'Z') value = c - 'A';
+    else if ('a' <= c && c <= 'z') value = c - 'a' + 26;
+    else if ('0' <= c && c <= '9') value = c - '0' + 52;
+    else if (c == '+' || c == '-') value = 62;
+    else if (c == '/' || c == '_') value = 63;
+    else return std::nullopt;
+
+    buffer = (buffer << 6) | value;
+    bits += 6;
+    if (bits >= 8) {
+      bits -= 8;
+      bytes.push_back(static_cast<char>((buffer >> bits) & 0xFF));
+    }
+  }
+  return bytes;
+}
+
+// Finds the digest for the given algorithm in a Digest (RFC 3230) or
+// Repr-Digest (RFC 9530) header value, e.g. "sha-256=X48E9q...=" or
+// "sha-256=:X48E9q...=:". Values are base64-encoded.
+[[nodiscard]] inline std::optional<std::string> find_digest(
+    std::string_view header, const std::string_view name) {
+  while (!header.empty()) {
+    const auto pos = header.find(',');
+    auto item = header.substr(0, pos);
+    header = pos != header.npos ? header.substr(pos + 1) : std::string_view{};
+
+    while (!item.empty() && item.front() == ' ') item.remove_prefix(1);
+    while (!item.empty() && item.back() == ' ') item.remove_suffix(1);
+
+    const auto eq = item.find('=');
+    if (eq == item.npos ||
+        !equals_case_insensitive(item.substr(0, eq), name)) {
+      continue;
+    }
+    auto value = item.substr(eq + 1);
+    if (value.size() >= 2 && value.front() == ':' && value.back() == ':') {
+      value = value.substr(1, value.size() - 2);
+    }
+    return from_base64(value);
+  }
+  return std::nullopt;
+}
+
+}  // namespace hypr::detail
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace hypr::detail {
+
+struct ServerSentEvent {
+  std::string type;
+  std::string data;
+  std::string id;
+};
+
+// Incremental parser for the text/event-stream format. Data can be fed in
+// chunks of any size, and events are dispatched as soon as they are complete.
+//
+// https://html.spec.whatwg.org/multipage/server-sent-events.html
+class EventStreamParser {
+public:
+  using handler_t = std::function<void(const ServerSentEvent&)>;
+
+  EventStreamParser() = default;
+  explicit EventStreamParser(std::string last_event_id)
+      : last_event_id_{std::move(last_event_id)} {}
+
+  void parse(std::string_view data, const handler_t& handler) {
+    while (!data.empty()) {
+      // A CRLF pair may be split between two chunks
+      if (skip_lf_) {
+        skip_lf_ = false;
+        if (data.front() == '\n') {
+          data.remove_prefix(1);
+          continue;
+        }
+      }
+
+      const auto pos = data.find_first_of("\r\n");
+      if (pos == data.npos) {
+        line_.append(data);
+        break;
+      }
+
+      line_.append(data.substr(0, pos));
+      skip_lf_ = data[pos] == '\r';
+      data.remove_prefix(pos + 1);
+
+      parse_line(handler);
+      line_.clear();
+    }
+  }
+
+  const std::string& last_event_id() const {
+    return last_event_id_;
+  }
+
+  std::optional<std::chrono::milliseconds> retry() const {
+    return retry_;
+  }
+
+private:
+  void parse_line(const handler_t& handler) {
+    std::string_view line = line_;
+
+    if (first_line_) {
+      first_line_ = false;
+      constexpr std::string_view bom = "\xEF\xBB\xBF";
+      if (line.substr(0, bom.size()) == bom) {
+        line.remove_prefix(bom.size());
+      }
+    }
+
+    if (line.empty()) {
+      dispatch(handler);
+      return;
+    }
+
+    if (line.front() == ':') {
+      return;  // comment
+    }
+
+    const auto pos = line.find(':');
+    const auto field = line.substr(0, pos);
+    auto value = pos != line.npos ? line.substr(pos + 1) : std::string_view{};
+    if (!value.empty() && value.front() == ' ') {
+      value.remove_prefix(1);
+    }
+
+    if (field == "event") {
+      type_ = value;
+    } else if (field == "data") {
+      data_.append(value);
+      data_.push_back('\n');
+    } else if (field == "id") {
+      if (value.find('\0') == value.npos) {
+        last_event_id_ = value;
+      }
+    } else if (field == "retry") {
+      int64_t retry = 0;
+      const auto [ptr, ec] =
+          std::from_chars(value.data(), value.data() + value.size(), retry);
+      if (ec == std::errc{} && ptr == value.data() + value.size() &&
+          retry >= 0) {
+        retry_ = std::chrono::milliseconds{retry};
+      }
+    }
+  }
+
+  void dispatch(const handler_t& handler) {
+    if (data_.empty()) {
+      type_.clear();
+      return;
+    }
+
+    data_.pop_back();  // trailing line feed
+
+    ServerSentEvent event;
+    event.type = !type_.empty() ? std::move(type_) : std::string{"message"};
+    event.data = std::move(data_);
+    event.id = last_event_id_;
+
+    type_.clear();
+    data_.clear();
+
+    if (handler) {
+      handler(event);
+    }
+  }
+
+  std::string line_;
+  std::string type_;
+  std::string data_;
+  std::string last_event_id_;
+  std::optional<std::chrono::milliseconds> retry_;
+  bool first_line_ = true;
+  bool skip_lf_ = false;
+};
+
+}  // namespace hypr::detail
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include <fcntl.h>
+#ifdef _WIN32
+#include <io.h>
+#include <sys/stat.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace hypr::detail {
+
+// A file that can be written at arbitrary offsets, so that several parts of
+// it can be downloaded at the same time.
+class File {
+public:
+  File() = default;
+  File(const File&) = delete;
+  File& operator=(const File&) = delete;
+
+  ~File() {
+    close();
+  }
+
+  // Existing files are kept as they are until they are resized
+  bool open(const std::string& path) {
+#ifdef _WIN32
+    fd_ = _open(path.c_str(), _O_CREAT | _O_WRONLY | _O_BINARY,
+                _S_IREAD | _S_IWRITE);
+#else
+    fd_ = ::open(path.c_str(), O_CREAT | O_WRONLY, 0644);
+#endif
+    return fd_ != -1;
+  }
+
+  void close() {
+    if (fd_ != -1) {
+#ifdef _WIN32
+      _close(fd_);
+#else
+      ::close(fd_);
+#endif
+      fd_ = -1;
+    }
+  }
+
+  // Sets the size of the file, reserving disk space for it where possible.
+  bool allocate(const uint64_t size) {
+#ifdef _WIN32
+    return _chsize_s(fd_, static_cast<__int64>(size)) == 0;
+#else
+    if (::ftruncate(fd_, static_cast<off_t>(size)) != 0) {
+      return false;
+    }
+#ifdef __linux__
+    ::posix_fallocate(fd_, 0, static_cast<off_t>(size));
+#endif
+    return true;
+#endif
+  }
+
+  bool truncate() {
+#ifdef _WIN32
+    return _chsize_s(fd_, 0) == 0;
+#else
+    return ::ftruncate(fd_, 0) == 0;
+#endif
+  }
+
+  bool write_at(uint64_t offset, std::string_view data) {
+    while (!data.empty()) {
+#ifdef _WIN32
+      if (_lseeki64(fd_, static_cast<__int64>(offset), SEEK_SET) == -1) {
+        return false;
+      }
+      const auto result =
+          _write(fd_, data.data(), static_cast<unsigned int>(data.size()));
+#else
+      const auto result = ::pwrite(fd_, data.data(), data.size(),
+                                   static_cast<off_t>(offset));
+#endif
+      if (result <= 0) {
+        return false;
+      }
+      data.remove_prefix(static_cast<size_t>(result));
+      offset += static_cast<uint64_t>(result);
+    }
+    return true;
+  }
+
+private:
+  int fd_ = -1;
+};
+
+}  // namespace hypr::detail
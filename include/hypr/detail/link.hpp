@@ -0,0 +1,100 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include <hypr/detail/util.hpp>
+
+namespace hypr::detail {
+
+// Finds the target of the link with the given relation in a Link header
+// (RFC 8288), e.g. `<https://api.example.com/items?page=2>; rel="next"`.
+// Relations are matched case-insensitively, and a link may have several of
+// them, separated by spaces.
+[[nodiscard]] inline std::optional<std::string> find_link(
+    std::string_view header, const std::string_view relation) {
+  const auto trim = [](std::string_view str) {
+    while (!str.empty() && (str.front() == ' ' || str.front() == '\t')) {
+      str.remove_prefix(1);
+    }
+    while (!str.empty() && (str.back() == ' ' || str.back() == '\t')) {
+      str.remove_suffix(1);
+    }
+    return str;
+  };
+
+  const auto has_relation = [&relation](std::string_view values) {
+    while (!values.empty()) {
+      const auto pos = values.find(' ');
+      if (equals_case_insensitive(values.substr(0, pos), relation)) {
+        return true;
+      }
+      values = pos != values.npos ? values.substr(pos + 1) : std::string_view{};
+    }
+    return false;
+  };
+
+  while (true) {
+    header = trim(header);
+    if (header.empty() || header.front() != '<') {
+      return std::nullopt;
+    }
+
+    // Targets may contain commas and semicolons, so they are skipped first
+    const auto target_end = header.find('>');
+    if (target_end == header.npos) {
+      return std::nullopt;
+    }
+    const auto target = header.substr(1, target_end - 1);
+    header.remove_prefix(target_end + 1);
+
+    // Parameters, up to the next link. Quoted values may contain commas.
+    bool found = false;
+    while (!header.empty() && header.front() != ',') {
+      header = trim(header);
+      if (header.empty() || header.front() != ';') {
+        break;
+      }
+      header = trim(header.substr(1));
+
+      const auto name_end = header.find_first_of("=;,");
+      const auto name = trim(header.substr(0, name_end));
+      header = name_end != header.npos ? header.substr(name_end)
+                                       : std::string_view{};
+      if (header.empty() || header.front() != '=') {
+        continue;
+      }
+      header = trim(header.substr(1));
+
+      std::string_view value;
+      if (!header.empty() && header.front() == '"') {
+        const auto quote = header.find('"', 1);
+        value = header.substr(1, quote != header.npos ? quote - 1 : quote);
+        header = quote != header.npos ? header.substr(quote + 1)
+                                      : std::string_view{};
+      } else {
+        const auto value_end = header.find_first_of(";,");
+        value = trim(header.substr(0, value_end));
+        header = value_end != header.npos ? header.substr(value_end)
+                                          : std::string_view{};
+      }
+
+      if (equals_case_insensitive(name, "rel") && has_relation(value)) {
+        found = true;
+      }
+    }
+
+    if (found) {
+      return std::string{target};
+    }
+
+    header = trim(header);
+    if (header.empty() || header.front() != ',') {
+      return std::nullopt;
+    }
+    header.remove_prefix(1);
+  }
+}
+
+}  // namespace hypr::detail
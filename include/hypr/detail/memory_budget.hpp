@@ -0,0 +1,178 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <utility>
+
+namespace hypr::detail {
+
+struct MemoryStats {
+  size_t budget = 0;  // 0 means no limit
+  size_t used = 0;
+  size_t peak = 0;
+  size_t paused = 0;  // transfers that are currently paused
+  uint64_t pauses = 0;  // total number of times a transfer was paused
+};
+
+// Process-wide limit for response bodies that are kept in memory. Transfers
+// that would go over the limit are paused until enough memory is released,
+// which happens when responses are destroyed.
+//
+// A single transfer at a time is allowed to go over the limit, so that there
+// is always some progress, even if the paused transfers together hold the
+// whole budget, or a response is larger than the budget itself.
+class MemoryBudget {
+public:
+  static MemoryBudget& instance() {
+    static MemoryBudget budget;
+    return budget;
+  }
+
+  void set_limit(const size_t limit) {
+    limit_.store(limit, std::memory_order_relaxed);
+  }
+
+  bool limited() const {
+    return limit_.load(std::memory_order_relaxed) != 0;
+  }
+
+  bool has_room() const {
+    const auto limit = limit_.load(std::memory_order_relaxed);
+    return !limit || used_.load(std::memory_order_relaxed) < limit ||
+           !overdraft_.load(std::memory_order_relaxed);
+  }
+
+  bool charge(const size_t size, const void* owner) {
+    const auto limit = limit_.load(std::memory_order_relaxed);
+    auto used = used_.load(std::memory_order_relaxed);
+    do {
+      if (limit && used + size > limit && !take_overdraft(owner)) {
+        return false;
+      }
+    } while (!used_.compare_exchange_weak(used, used + size,
+                                          std::memory_order_relaxed));
+
+    auto peak = peak_.load(std::memory_order_relaxed);
+    while (used + size > peak &&
+           !peak_.compare_exchange_weak(peak, used + size,
+                                        std::memory_order_relaxed)) {
+    }
+    return true;
+  }
+
+  void release(const size_t size) {
+    used_.fetch_sub(size, std::memory_order_relaxed);
+  }
+
+  void release_overdraft(const void* owner) {
+    overdraft_.compare_exchange_strong(owner, nullptr,
+                                       std::memory_order_relaxed);
+  }
+
+  void pause() {
+    paused_.fetch_add(1, std::memory_order_relaxed);
+    pauses_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void resume() {
+    paused_.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  MemoryStats stats() const {
+    MemoryStats stats;
+    stats.budget = limit_.load(std::memory_order_relaxed);
+    stats.used = used_.load(std::memory_order_relaxed);
+    stats.peak = peak_.load(std::memory_order_relaxed);
+    stats.paused = paused_.load(std::memory_order_relaxed);
+    stats.pauses = pauses_.load(std::memory_order_relaxed);
+    return stats;
+  }
+
+private:
+  bool take_overdraft(const void* owner) {
+    const void* expected = nullptr;
+    return overdraft_.compare_exchange_strong(expected, owner,
+                                              std::memory_order_relaxed) ||
+           expected == owner;
+  }
+
+  std::atomic<const void*> overdraft_{nullptr};
+  std::atomic<size_t> limit_{0};
+  std::atomic<size_t> used_{0};
+  std::atomic<size_t> peak_{0};
+  std::atomic<size_t> paused_{0};
+  std::atomic<uint64_t> pauses_{0};
+};
+
+// The part of the budget that is used by a single response. Released when the
+// response is destroyed. Copies of a response are not accounted for.
+//
+// `finish` must be called once the transfer is complete, before the charge is
+// moved elsewhere.
+class MemoryCharge {
+public:
+  MemoryCharge() = default;
+  MemoryCharge(const MemoryCharge&) {}
+  MemoryCharge(MemoryCharge&& other) noexcept
+      : size_{std::exchange(other.size_, 0)},
+        paused_{std::exchange(other.paused_, false)} {}
+
+  ~MemoryCharge() {
+    reset();
+  }
+
+  MemoryCharge& operator=(const MemoryCharge&) {
+    reset();
+    return *this;
+  }
+  MemoryCharge& operator=(MemoryCharge&& other) noexcept {
+    if (this != &other) {
+      reset();
+      size_ = std::exchange(other.size_, 0);
+      paused_ = std::exchange(other.paused_, false);
+    }
+    return *this;
+  }
+
+  bool add(const size_t size) {
+    if (!MemoryBudget::instance().charge(size, this)) {
+      return false;
+    }
+    size_ += size;
+    return true;
+  }
+
+  bool paused() const {
+    return paused_;
+  }
+  void pause() {
+    if (!paused_) {
+      paused_ = true;
+      MemoryBudget::instance().pause();
+    }
+  }
+  void resume() {
+    if (paused_) {
+      paused_ = false;
+      MemoryBudget::instance().resume();
+    }
+  }
+
+  void finish() {
+    resume();
+    MemoryBudget::instance().release_overdraft(this);
+  }
+
+private:
+  void reset() {
+    finish();
+    if (size_) {
+      MemoryBudget::instance().release(std::exchange(size_, 0));
+    }
+  }
+
+  size_t size_ = 0;
+  bool paused_ = false;
+};
+
+}  // namespace hypr::detail
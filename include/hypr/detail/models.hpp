@@ -1,17 +1,24 @@
 #pragma once
 
 #include <chrono>
+#include <cstdint>
 #include <functional>
 #include <map>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 #include <curl/curl.h>
 #include <hypp/header.hpp>
 #include <hypp/response.hpp>
 
+#include <hypr/detail/context.hpp>
 #include <hypr/detail/curl_error.hpp>
 #include <hypr/detail/curl_session.hpp>
+#include <hypr/detail/digest.hpp>
+#include <hypr/detail/memory_budget.hpp>
 #include <hypr/detail/util.hpp>
 
 namespace hypr::detail {
@@ -29,11 +36,74 @@ struct Transfer {
 struct Callbacks {
   std::function<void(const curl_infotype, std::string_view)> debug;
   std::function<bool(const Transfer&)> transfer;
+  // Receives the body as it arrives instead of it being stored in the
+  // response. Returning false aborts the transfer.
+  std::function<bool(std::string_view)> write;
+};
+
+struct MimePart {
+  // Fills the buffer with up to `size` bytes and returns the number of bytes
+  // written, or 0 when there is no more data.
+  using reader_t = std::function<size_t(char* buffer, size_t size)>;
+
+  std::string name;
+  std::string data;
+  std::string path;
+  reader_t reader;
+  std::optional<uint64_t> size;  // unknown sizes are sent in chunks
+  std::string filename;
+  std::string media_type;
+};
+
+enum class Priority {
+  Low,
+  Normal,
+  High,
 };
 
 class Request : public hypp::Request {
 public:
   Headers headers;
+  std::vector<MimePart> multipart;
+  Priority priority = Priority::Normal;
+};
+
+// Header nodes of an earlier response, kept so that a later one can take them
+// over instead of allocating its own. Copies start out empty.
+class HeaderNodes {
+public:
+  HeaderNodes() = default;
+  HeaderNodes(const HeaderNodes&) {}
+  HeaderNodes(HeaderNodes&&) = default;
+
+  HeaderNodes& operator=(const HeaderNodes&) {
+    return *this;
+  }
+  HeaderNodes& operator=(HeaderNodes&&) = default;
+
+  void take(Headers& headers) {
+    while (!headers.empty()) {
+      nodes_.push_back(headers.extract(headers.begin()));
+    }
+  }
+
+  // Same as `headers.emplace`, except that it uses a spare node if possible
+  void emplace(Headers& headers, std::string&& name, std::string&& value) {
+    if (nodes_.empty()) {
+      headers.emplace(std::move(name), std::move(value));
+      return;
+    }
+    auto node = std::move(nodes_.back());
+    nodes_.pop_back();
+    node.key() = std::move(name);
+    node.mapped() = std::move(value);
+    if (auto result = headers.insert(std::move(node)); !result.inserted) {
+      nodes_.push_back(std::move(result.node));
+    }
+  }
+
+private:
+  std::vector<Headers::node_type> nodes_;
 };
 
 class Response : public hypp::Response {
@@ -41,14 +111,52 @@ public:
   Response() = default;
   Response(const CURLcode code) : error{code} {}
 
+  // Clears the response for another transfer, keeping the capacity of its
+  // body and URL, and the nodes of its headers. The strings of parsed header
+  // fields are not kept, as the parser allocates its own.
+  void recycle() {
+    start_line = {};
+    header_fields.clear();
+    body.clear();
+
+    // The context is replaced by the next transfer, and resetting it here
+    // would allocate a new cancellation token
+    callbacks = {};
+    error = {};
+    spare_headers.take(headers);
+    transfer = {};
+    elapsed = {};
+    url.clear();
+    digester.reset();
+    expected_digest.clear();
+    digest.clear();
+    memory = MemoryCharge{};
+    buffer_host.reset();
+    session = nullptr;
+  }
+
   Callbacks callbacks;
+  Context context;
   Error error;
   Headers headers;
   Transfer transfer;
   std::chrono::microseconds elapsed{0};
   std::string url;
 
+  // Computed while the body is received, if requested
+  std::optional<Digester> digester;
+  std::string expected_digest;
+  std::string digest;
+
+  // Part of the memory budget that is used by the body
+  MemoryCharge memory;
+
+  // Host whose buffer sizes are tuned once the transfer is complete
+  std::optional<std::string> buffer_host;
+
   curl::Session* session = nullptr;
+
+  HeaderNodes spare_headers;
 };
 
 }  // namespace hypr::detail
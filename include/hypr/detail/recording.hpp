@@ -0,0 +1,211 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <istream>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+#include <hypr/models.hpp>
+
+namespace hypr::detail::recording {
+
+// A recording starts with a signature, followed by one record per exchange:
+//
+//   u64 offset (microseconds since the recording started)
+//   str method, str target, headers, str body       (request)
+//   u32 error, u32 status, str url, headers, str body, u64 elapsed  (response)
+//
+// Integers are little-endian. Strings are prefixed with their u32 length, and
+// headers with their u32 count, each followed by a name and a value.
+constexpr std::string_view kSignature = "HYPRREC\x01";
+
+struct Exchange {
+  std::chrono::microseconds offset{0};
+  hypr::Request request;
+  hypr::Response response;
+};
+
+class Writer {
+public:
+  explicit Writer(std::ostream& stream) : stream_{stream} {}
+
+  void write_signature() {
+    stream_.write(kSignature.data(), kSignature.size());
+  }
+
+  void write(const Exchange& exchange) {
+    write_u64(exchange.offset.count());
+
+    const auto& request = exchange.request;
+    write_str(request.method());
+    write_str(hypp::to_string(request.target()));
+    write_headers(request.headers());
+    write_str(request.body());
+
+    const auto& response = exchange.response;
+    write_u32(response.error().code);
+    write_u32(response.status_code());
+    write_str(response.url());
+    write_headers(response.headers());
+    write_str(response.body());
+    write_u64(response.elapsed().count());
+  }
+
+private:
+  void write_u32(const uint32_t value) {
+    char bytes[4];
+    for (size_t i = 0; i < sizeof(bytes); ++i) {
+      bytes[i] = static_cast<char>((value >> (i * 8)) & 0xFF);
+    }
+    stream_.write(bytes, sizeof(bytes));
+  }
+
+  void write_u64(const uint64_t value) {
+    char bytes[8];
+    for (size_t i = 0; i < sizeof(bytes); ++i) {
+      bytes[i] = static_cast<char>((value >> (i * 8)) & 0xFF);
+    }
+    stream_.write(bytes, sizeof(bytes));
+  }
+
+  void write_str(const std::string_view str) {
+    write_u32(static_cast<uint32_t>(str.size()));
+    stream_.write(str.data(), str.size());
+  }
+
+  void write_headers(const hypr::Headers& headers) {
+    write_u32(static_cast<uint32_t>(headers.size()));
+    for (const auto& [name, value] : headers) {
+      write_str(name);
+      write_str(value);
+    }
+  }
+
+  std::ostream& stream_;
+};
+
+class Reader {
+public:
+  explicit Reader(std::istream& stream) : stream_{stream} {}
+
+  bool read_signature() {
+    std::string signature(kSignature.size(), '\0');
+    stream_.read(signature.data(), signature.size());
+    return stream_ && signature == kSignature;
+  }
+
+  // Returns nothing at the end of the stream, or if the record is malformed.
+  std::optional<Exchange> read() {
+    Exchange exchange;
+
+    uint64_t offset = 0;
+    if (!read_u64(offset)) {
+      return std::nullopt;
+    }
+    exchange.offset = std::chrono::microseconds{offset};
+
+    std::string method, target, body;
+    hypr::Headers headers;
+    if (!read_str(method) || !read_str(target) || !read_headers(headers) ||
+        !read_str(body)) {
+      return std::nullopt;
+    }
+    auto& request = exchange.request;
+    if (!request.set_method(method) || !request.set_target(target)) {
+      return std::nullopt;
+    }
+    // Headers are restored after the body, which would otherwise add a
+    // Content-Type that was not sent
+    if (!body.empty()) {
+      request.set_body(hypr::Body{body});
+    }
+    request.set_headers(headers);
+
+    uint32_t error = 0, status = 0;
+    std::string url;
+    uint64_t elapsed = 0;
+    headers.clear();
+    body.clear();
+    if (!read_u32(error) || !read_u32(status) || !read_str(url) ||
+        !read_headers(headers) || !read_str(body) || !read_u64(elapsed)) {
+      return std::nullopt;
+    }
+    auto& response = exchange.response;
+    response = hypr::Response(static_cast<CURLcode>(error));
+    response.set_status_code(static_cast<hypr::StatusCode>(status));
+    response.set_url(url);
+    response.set_headers(headers);
+    response.set_body(std::move(body));
+    response.set_elapsed(std::chrono::microseconds{elapsed});
+
+    return exchange;
+  }
+
+private:
+  bool read_u32(uint32_t& value) {
+    unsigned char bytes[4];
+    if (!stream_.read(reinterpret_cast<char*>(bytes), sizeof(bytes))) {
+      return false;
+    }
+    value = 0;
+    for (size_t i = 0; i < sizeof(bytes); ++i) {
+      value |= static_cast<uint32_t>(bytes[i]) << (i * 8);
+    }
+    return true;
+  }
+
+  bool read_u64(uint64_t& value) {
+    unsigned char bytes[8];
+    if (!stream_.read(reinterpret_cast<char*>(bytes), sizeof(bytes))) {
+      return false;
+    }
+    value = 0;
+    for (size_t i = 0; i < sizeof(bytes); ++i) {
+      value |= static_cast<uint64_t>(bytes[i]) << (i * 8);
+    }
+    return true;
+  }
+
+  bool read_str(std::string& str) {
+    uint32_t size = 0;
+    if (!read_u32(size)) {
+      return false;
+    }
+    // Read in chunks, so that a malformed size cannot allocate a lot at once
+    constexpr uint32_t chunk_size = 64 * 1024;
+    str.clear();
+    while (size) {
+      const auto chunk = std::min(size, chunk_size);
+      const auto pos = str.size();
+      str.resize(pos + chunk);
+      if (!stream_.read(str.data() + pos, chunk)) {
+        return false;
+      }
+      size -= chunk;
+    }
+    return true;
+  }
+
+  bool read_headers(hypr::Headers& headers) {
+    uint32_t count = 0;
+    if (!read_u32(count)) {
+      return false;
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+      std::string name, value;
+      if (!read_str(name) || !read_str(value)) {
+        return false;
+      }
+      headers.emplace(std::move(name), std::move(value));
+    }
+    return true;
+  }
+
+  std::istream& stream_;
+};
+
+}  // namespace hypr::detail::recording
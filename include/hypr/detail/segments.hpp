@@ -0,0 +1,77 @@
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include <hypp/status.hpp>
+
+#include <hypr/detail/util.hpp>
+#include <hypr/models.hpp>
+
+namespace hypr::detail {
+
+// A part of a file that is downloaded on its own connection
+struct Segment {
+  uint64_t remaining() const {
+    return end - begin - written;
+  }
+
+  uint64_t begin = 0;
+  uint64_t end = 0;  // exclusive
+  uint64_t written = 0;
+  bool ranged = false;
+  bool pending = true;
+  int attempts = 0;
+};
+
+// Returns the size of the file if the response to a HEAD request says that
+// range requests are accepted for it.
+[[nodiscard]] inline std::optional<uint64_t> get_ranged_size(
+    const hypr::Response& response) {
+  if (response.error() || response.status_code() != hypp::status::k200_OK) {
+    return std::nullopt;
+  }
+
+  const auto accept_ranges = response.header("accept-ranges");
+  if (!equals_case_insensitive(accept_ranges, "bytes")) {
+    return std::nullopt;
+  }
+
+  const auto content_length = response.header("content-length");
+  const auto end = content_length.data() + content_length.size();
+  uint64_t size = 0;
+  const auto [ptr, ec] = std::from_chars(content_length.data(), end, size);
+  if (ec != std::errc{} || ptr != end || !size) {
+    return std::nullopt;
+  }
+
+  return size;
+}
+
+// Splits a file into at most `max_segments` segments of at least
+// `min_segment_size` bytes each. Files of unknown size are downloaded as a
+// whole.
+[[nodiscard]] inline std::vector<Segment> split_segments(
+    const std::optional<uint64_t> size, const size_t max_segments,
+    const uint64_t min_segment_size) {
+  if (!size) {
+    return {Segment{}};
+  }
+
+  const auto count = std::clamp<uint64_t>(
+      *size / std::max<uint64_t>(min_segment_size, 1), 1,
+      std::max<size_t>(max_segments, 1));
+
+  std::vector<Segment> segments(count);
+  for (uint64_t i = 0; i < count; ++i) {
+    segments[i].begin = *size * i / count;
+    segments[i].end = *size * (i + 1) / count;
+    segments[i].ranged = true;
+  }
+  return segments;
+}
+
+}  // namespace hypr::detail
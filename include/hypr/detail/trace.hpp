@@ -0,0 +1,246 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <curl/curl.h>
+
+#include <hypr/detail/curl_session.hpp>
+
+namespace hypr::detail::trace {
+
+enum class EventType : uint8_t {
+  NameResolved,  // which is also when connecting starts
+  ConnectDone,
+  TlsDone,
+  RequestSent,
+  FirstByte,
+  Complete,  // value is the status code
+  Reuse,
+  Error,  // value is the CURLcode
+};
+
+struct Event {
+  std::chrono::steady_clock::time_point time;
+  uint64_t transfer = 0;
+  uint32_t thread = 0;
+  EventType type = EventType::Complete;
+  int64_t value = 0;
+};
+
+// A fixed-size buffer of the most recent events of a single thread. Only the
+// owning thread writes to it, while any thread can take a snapshot. Each slot
+// is guarded by a sequence number, so that readers can skip slots that are
+// being overwritten instead of waiting for the writer.
+class Ring {
+public:
+  static constexpr size_t kCapacity = 4096;
+
+  explicit Ring(const uint32_t thread) : thread_{thread} {}
+
+  void push(const EventType type, const uint64_t transfer,
+            const std::chrono::steady_clock::time_point time,
+            const int64_t value) {
+    const auto index = head_.load(std::memory_order_relaxed);
+    auto& slot = slots_[index % kCapacity];
+
+    const auto sequence = slot.sequence.load(std::memory_order_relaxed);
+    slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot.time.store(time.time_since_epoch().count(),
+                    std::memory_order_relaxed);
+    slot.transfer.store(transfer, std::memory_order_relaxed);
+    slot.type.store(type, std::memory_order_relaxed);
+    slot.value.store(value, std::memory_order_relaxed);
+
+    slot.sequence.store(sequence + 2, std::memory_order_release);
+    head_.store(index + 1, std::memory_order_release);
+  }
+
+  void snapshot(std::vector<Event>& events) const {
+    const auto head = head_.load(std::memory_order_acquire);
+    const auto tail = head > kCapacity ? head - kCapacity : 0;
+
+    for (auto index = tail; index < head; ++index) {
+      const auto& slot = slots_[index % kCapacity];
+
+      const auto sequence = slot.sequence.load(std::memory_order_acquire);
+      if (sequence % 2) {
+        continue;
+      }
+
+      Event event;
+      event.time = std::chrono::steady_clock::time_point{
+          std::chrono::steady_clock::duration{
+              slot.time.load(std::memory_order_relaxed)}};
+      event.transfer = slot.transfer.load(std::memory_order_relaxed);
+      event.thread = thread_;
+      event.type = slot.type.load(std::memory_order_relaxed);
+      event.value = slot.value.load(std::memory_order_relaxed);
+
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (slot.sequence.load(std::memory_order_relaxed) == sequence) {
+        events.push_back(event);
+      }
+    }
+  }
+
+private:
+  struct Slot {
+    std::atomic<uint64_t> sequence{0};
+    std::atomic<std::chrono::steady_clock::rep> time{0};
+    std::atomic<uint64_t> transfer{0};
+    std::atomic<EventType> type{EventType::Complete};
+    std::atomic<int64_t> value{0};
+  };
+
+  const uint32_t thread_;
+  std::atomic<uint64_t> head_{0};
+  std::array<Slot, kCapacity> slots_;
+};
+
+using error_handler_t = std::function<void(const std::vector<Event>&)>;
+
+// Rings are kept after their threads exit, so that their events can still be
+// looked at afterwards, and are handed to new threads later on. Thread numbers
+// in events therefore identify rings rather than threads, and there are only
+// ever as many rings as threads that were tracing at the same time.
+class Registry {
+public:
+  static Registry& instance() {
+    static Registry registry;
+    return registry;
+  }
+
+  Ring& local() {
+    thread_local const Lease lease{*this};
+    return *lease.ring;
+  }
+
+  std::vector<Event> dump() {
+    std::vector<Event> events;
+    {
+      std::lock_guard lock{mutex_};
+      for (const auto& ring : rings_) {
+        ring->snapshot(events);
+      }
+    }
+    std::sort(events.begin(), events.end(),
+              [](const Event& a, const Event& b) { return a.time < b.time; });
+    return events;
+  }
+
+  error_handler_t error_handler() {
+    std::lock_guard lock{mutex_};
+    return error_handler_;
+  }
+  void set_error_handler(error_handler_t handler) {
+    std::lock_guard lock{mutex_};
+    error_handler_ = std::move(handler);
+  }
+
+  uint64_t next_transfer() {
+    return ++transfer_count_;
+  }
+
+private:
+  // Hands the ring of a thread back once the thread exits
+  struct Lease {
+    explicit Lease(Registry& registry)
+        : registry{registry}, ring{registry.acquire()} {}
+    ~Lease() {
+      registry.release(ring);
+    }
+
+    Registry& registry;
+    Ring* const ring;
+  };
+
+  Ring* acquire() {
+    std::lock_guard lock{mutex_};
+    if (!idle_rings_.empty()) {
+      const auto ring = idle_rings_.back();
+      idle_rings_.pop_back();
+      return ring;
+    }
+    const auto thread = static_cast<uint32_t>(rings_.size());
+    return rings_.emplace_back(std::make_unique<Ring>(thread)).get();
+  }
+
+  void release(Ring* ring) {
+    std::lock_guard lock{mutex_};
+    idle_rings_.push_back(ring);
+  }
+
+  std::mutex mutex_;
+  std::vector<std::unique_ptr<Ring>> rings_;
+  std::vector<Ring*> idle_rings_;
+  error_handler_t error_handler_;
+  std::atomic<uint64_t> transfer_count_{0};
+};
+
+inline std::atomic<bool> enabled{false};
+
+// Records the events of a finished transfer. They are reconstructed from the
+// timing information that libcurl collects anyway, so tracing costs nothing
+// while the transfer is running.
+inline void record(const curl::Session& session, const CURLcode code) {
+  if (!enabled.load(std::memory_order_relaxed)) {
+    return;
+  }
+
+  const auto now = std::chrono::steady_clock::now();
+
+  const auto get_time = [&session](const CURLINFO info) {
+    curl_off_t time = 0;
+    session.getinfo(info, time);
+    return std::chrono::microseconds{time};
+  };
+  const auto total = get_time(CURLINFO_TOTAL_TIME_T);
+  const auto start = now - total;
+
+  long connects = 0;
+  session.getinfo(CURLINFO_NUM_CONNECTS, connects);
+  long status = 0;
+  session.getinfo(CURLINFO_RESPONSE_CODE, status);
+
+  auto& registry = Registry::instance();
+  auto& ring = registry.local();
+  const auto transfer = registry.next_transfer();
+
+  const auto push = [&](const EventType type, const CURLINFO info) {
+    if (const auto time = get_time(info); time.count() > 0) {
+      ring.push(type, transfer, start + time, 0);
+    }
+  };
+
+  if (!connects && code == CURLE_OK) {
+    ring.push(EventType::Reuse, transfer, start, 0);
+  } else {
+    push(EventType::NameResolved, CURLINFO_NAMELOOKUP_TIME_T);
+    push(EventType::ConnectDone, CURLINFO_CONNECT_TIME_T);
+    push(EventType::TlsDone, CURLINFO_APPCONNECT_TIME_T);
+  }
+  push(EventType::RequestSent, CURLINFO_PRETRANSFER_TIME_T);
+  push(EventType::FirstByte, CURLINFO_STARTTRANSFER_TIME_T);
+  ring.push(EventType::Complete, transfer, now, status);
+
+  if (code != CURLE_OK) {
+    ring.push(EventType::Error, transfer, now, code);
+    if (const auto handler = registry.error_handler()) {
+      std::vector<Event> events;
+      ring.snapshot(events);
+      handler(events);
+    }
+  }
+}
+
+}  // namespace hypr::detail::trace
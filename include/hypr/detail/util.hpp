@@ -1,6 +1,8 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <cstdint>
 #include <string>
 #include <string_view>
 
@@ -19,6 +21,128 @@ namespace hypr::detail {
   return std::move(str);
 }
 
+[[nodiscard]] inline bool equals_case_insensitive(const std::string_view lhs,
+                                                  const std::string_view rhs) {
+  return std::equal(lhs.cbegin(), lhs.cend(), rhs.cbegin(), rhs.cend(),
+                    [](const char a, const char b) {
+                      return to_lower(a) == to_lower(b);
+                    });
+}
+
+// Unreserved characters are copied as is, everything else is percent-encoded.
+// https://www.rfc-editor.org/rfc/rfc3986#section-2.3
+inline constexpr auto kUnreservedTable = [] {
+  std::array<bool, 256> table{};
+  for (int c = 'A'; c <= 'Z'; ++c) table[c] = true;
+  for (int c = 'a'; c <= 'z'; ++c) table[c] = true;
+  for (int c = '0'; c <= '9'; ++c) table[c] = true;
+  for (const auto c : {'-', '.', '_', '~'}) table[c] = true;
+  return table;
+}();
+
+[[nodiscard]] constexpr bool is_unreserved(const char c) {
+  return kUnreservedTable[static_cast<uint8_t>(c)];
+}
+
+[[nodiscard]] constexpr size_t percent_encoded_size(const std::string_view str) {
+  size_t size = str.size();
+  for (const auto c : str) {
+    size += is_unreserved(c) ? 0 : 2;
+  }
+  return size;
+}
+
+// Appends to the output, copying runs of unreserved characters at once. The
+// output should have been reserved beforehand with `percent_encoded_size`.
+inline void percent_encode(std::string_view str, std::string& output) {
+  constexpr std::string_view digits = "0123456789ABCDEF";
+
+  while (!str.empty()) {
+    const auto it = std::find_if_not(str.cbegin(), str.cend(), is_unreserved);
+    const auto run = static_cast<size_t>(it - str.cbegin());
+    output.append(str.data(), run);
+    if (run == str.size()) {
+      break;
+    }
+    const auto c = static_cast<uint8_t>(str[run]);
+    const char encoded[] = {'%', digits[c >> 4], digits[c & 0x0F]};
+    output.append(encoded, sizeof(encoded));
+    str.remove_prefix(run + 1);
+  }
+}
+
+[[nodiscard]] inline std::string percent_encode(const std::string_view str) {
+  std::string output;
+  output.reserve(percent_encoded_size(str));
+  percent_encode(str, output);
+  return output;
+}
+
+// Replaces the scheme and authority of a URL with those of the base, which
+// may also have a path prefix. For example, "https://example.com/a?b" with
+// "http://localhost:8080" becomes "http://localhost:8080/a?b".
+[[nodiscard]] inline std::string rebase_url(std::string_view url,
+                                            std::string_view base) {
+  if (const auto scheme = url.find("://"); scheme != url.npos) {
+    const auto pos = url.find_first_of("/?#", scheme + 3);
+    url = pos != url.npos ? url.substr(pos) : std::string_view{};
+  }
+  if (!base.empty() && base.back() == '/' && !url.empty() &&
+      url.front() == '/') {
+    base.remove_suffix(1);
+  }
+  std::string rebased;
+  rebased.reserve(base.size() + url.size());
+  rebased.append(base).append(url);
+  return rebased;
+}
+
+// Resolves a reference, such as the target of a Link header, against the URL
+// that it was found at. Dot segments are left as they are.
+[[nodiscard]] inline std::string resolve_url(const std::string_view base,
+                                             const std::string_view reference) {
+  const auto scheme_end = base.find("://");
+  if (scheme_end == base.npos || reference.empty()) {
+    return std::string{reference.empty() ? base : reference};
+  }
+
+  // Absolute URL
+  const auto colon = reference.find(':');
+  if (colon != reference.npos && colon < reference.find_first_of("/?#")) {
+    return std::string{reference};
+  }
+
+  // Network-path reference, e.g. "//example.com/a"
+  if (reference.substr(0, 2) == "//") {
+    return std::string{base.substr(0, scheme_end + 1)}.append(reference);
+  }
+
+  const auto authority_end = base.find_first_of("/?#", scheme_end + 3);
+  const auto origin = base.substr(0, authority_end);
+  const auto path = authority_end != base.npos
+                        ? base.substr(authority_end,
+                                      base.find_first_of("?#", authority_end) -
+                                          authority_end)
+                        : std::string_view{};
+
+  std::string resolved{origin};
+  switch (reference.front()) {
+    case '/':
+      break;
+    case '?':
+      resolved.append(path.empty() ? "/" : path);
+      break;
+    default:
+      resolved.append(path.substr(0, path.rfind('/') + 1));
+      if (path.empty()) {
+        resolved.push_back('/');
+      }
+      break;
+  }
+  resolved.append(reference);
+  return resolved;
+}
+
 struct CaseInsensitiveCompare {
   bool operator()(const std::string_view lhs,
                   const std::string_view rhs) const {
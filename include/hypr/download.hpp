@@ -0,0 +1,195 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <hypp/method.hpp>
+#include <hypp/status.hpp>
+
+#include <hypr/detail/curl_dispatcher.hpp>
+#include <hypr/detail/digest.hpp>
+#include <hypr/detail/file.hpp>
+#include <hypr/detail/segments.hpp>
+#include <hypr/detail/util.hpp>
+#include <hypr/models.hpp>
+#include <hypr/session.hpp>
+
+namespace hypr {
+
+// Downloads a file over several connections at once. The file is split into
+// segments if the server supports range requests, and each segment is written
+// to its place in the file as it arrives. Failed segments are resumed from
+// where they left off.
+//
+// Segments cannot be verified on their own, so if a digest is expected, it is
+// checked against the whole file once every segment is complete.
+class Downloader {
+public:
+  Error download(const Request& request, const std::string& path) {
+    const auto size = probe(request);
+
+    // Existing files are not truncated until there is something to replace
+    // them with
+    detail::File file;
+    if (!file.open(path)) {
+      return Error{CURLE_WRITE_ERROR};
+    }
+    if (size && !file.allocate(*size)) {
+      return Error{CURLE_WRITE_ERROR};
+    }
+    auto segments = detail::split_segments(size, max_segments,
+                                           min_segment_size);
+
+    // Digests of segments would only describe a part of the file
+    auto segment_options = options;
+    if (size) {
+      segment_options.digest = DigestAlgorithm::None;
+      segment_options.expected_digest.clear();
+    }
+
+    detail::curl::Dispatcher dispatcher;
+    if (!dispatcher.init()) {
+      return Error{CURLE_FAILED_INIT};
+    }
+
+    // Cancelled when a segment fails for good, so that the others stop too
+    const auto download_context = context.child();
+    Error error;
+
+    const auto on_complete = [&](detail::Segment& segment,
+                                 Response&& response) {
+      const auto expected_status = segment.ranged
+          ? hypp::status::k206_Partial_Content
+          : hypp::status::k200_OK;
+      const bool complete = segment.ranged ? segment.remaining() == 0
+                                           : !size || segment.written == *size;
+      if (!response.error() && response.status_code() == expected_status &&
+          complete) {
+        return;
+      }
+
+      if (!download_context.cancelled() && segment.attempts++ < max_retries) {
+        segment.pending = true;
+      } else if (!error) {
+        error = response.error() ? response.error()
+                                 : Error{CURLE_HTTP_RETURNED_ERROR};
+        download_context.cancellation.cancel();
+      }
+    };
+
+    const auto start = [&](detail::Segment& segment) {
+      auto segment_request = request;
+      if (segment.ranged) {
+        segment_request.set_header("Range",
+            "bytes=" + std::to_string(segment.begin + segment.written) + "-" +
+            std::to_string(segment.end - 1));
+      } else {
+        segment.written = 0;
+      }
+
+      auto segment_callbacks = callbacks;
+      segment_callbacks.write = [&file, &segment](std::string_view data) {
+        if (segment.ranged && data.size() > segment.remaining()) {
+          return false;
+        }
+        // Whatever an earlier attempt wrote is replaced
+        if (!segment.ranged && !segment.written && !file.truncate()) {
+          return false;
+        }
+        if (!file.write_at(segment.begin + segment.written, data)) {
+          return false;
+        }
+        segment.written += data.size();
+        return true;
+      };
+
+      dispatcher.add(segment_request, segment_callbacks, segment_options, proxy,
+                     download_context,
+                     [&on_complete, &segment](Response&& response) {
+                       on_complete(segment, std::move(response));
+                     });
+    };
+
+    const auto has_pending = [&segments]() {
+      return std::any_of(segments.begin(), segments.end(),
+          [](const detail::Segment& segment) { return segment.pending; });
+    };
+
+    while (true) {
+      // Segments that fail to start are completed right away, and may be
+      // pending again afterwards
+      for (auto& segment : segments) {
+        if (segment.pending) {
+          segment.pending = false;
+          start(segment);
+        }
+      }
+      if (!dispatcher.active()) {
+        if (has_pending()) {
+          continue;
+        }
+        break;
+      }
+
+      int running_handles = 0;
+      dispatcher.multi().perform(running_handles);
+      dispatcher.complete();
+
+      if (dispatcher.active() && !has_pending()) {
+        dispatcher.multi().poll(std::chrono::seconds{1});
+      }
+    }
+
+    if (!error && size) {
+      file.close();
+      error = verify(path);
+    }
+
+    return error;
+  }
+
+  Callbacks callbacks;
+  Context context;
+  Options options;
+  Proxy proxy;
+
+  size_t max_segments = 4;
+  uint64_t min_segment_size = 1024 * 1024;
+  int max_retries = 3;
+
+private:
+  Error verify(const std::string& path) const {
+    if (options.digest == DigestAlgorithm::None ||
+        options.expected_digest.empty()) {
+      return {};
+    }
+    const auto digest = detail::digest_file(path, options.digest);
+    if (!digest) {
+      return Error{CURLE_READ_ERROR};
+    }
+    if (!detail::equals_case_insensitive(*digest, options.expected_digest)) {
+      return Error{CURLE_BAD_CONTENT_ENCODING};
+    }
+    return {};
+  }
+
+  // Returns the size of the file if the server accepts range requests for it
+  std::optional<uint64_t> probe(const Request& request) const {
+    auto head_request = request;
+    head_request.set_method(hypp::method::kHead);
+
+    Session session;
+    session.options = options;
+    session.options.digest = DigestAlgorithm::None;
+    session.options.expected_digest.clear();
+    session.proxy = proxy;
+    session.context = context;
+    return detail::get_ranged_size(session.send(head_request));
+  }
+};
+
+}  // namespace hypr
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <optional>
+
+#include <curl/curl.h>
+
+#include <hypr/detail/curl_dispatcher.hpp>
+#include <hypr/models.hpp>
+
+namespace hypr {
+
+// Runs transfers on an event loop that is owned by the caller. The driver
+// tells the loop which sockets to watch and when to wake up, and the loop
+// calls back into the driver when that happens. Everything must be called
+// from the thread that runs the loop.
+class Driver {
+public:
+  using handler_t = std::function<void(Response&&)>;
+
+  // Bitmask of socket events
+  enum Event : int {
+    kNone = 0,
+    kRead = CURL_CSELECT_IN,
+    kWrite = CURL_CSELECT_OUT,
+    kError = CURL_CSELECT_ERR,
+  };
+
+  // Called with the events to watch a socket for, or `kNone` if the socket
+  // should no longer be watched.
+  using socket_handler_t = std::function<void(curl_socket_t, int events)>;
+  // Called with the time after which `on_timeout` should be called, or
+  // nullopt if the previous timer should be cancelled. The handler must not
+  // call `on_timeout` directly.
+  using timer_handler_t =
+      std::function<void(std::optional<std::chrono::milliseconds>)>;
+
+  Driver(socket_handler_t socket_handler, timer_handler_t timer_handler)
+      : socket_handler_{std::move(socket_handler)},
+        timer_handler_{std::move(timer_handler)} {
+    if (dispatcher_.init()) {
+      const auto& multi = dispatcher_.multi();
+      multi.setopt(CURLMOPT_SOCKETFUNCTION, socket_callback);
+      multi.setopt(CURLMOPT_SOCKETDATA, this);
+      multi.setopt(CURLMOPT_TIMERFUNCTION, timer_callback);
+      multi.setopt(CURLMOPT_TIMERDATA, this);
+    }
+  }
+
+  Driver(const Driver&) = delete;
+  Driver& operator=(const Driver&) = delete;
+
+  bool send_async(const Request& request, handler_t handler) {
+    return dispatcher_.add(request, callbacks, options, proxy, context,
+                           std::move(handler));
+  }
+
+  void on_socket_ready(const curl_socket_t socket, const int events) {
+    int running_handles = 0;
+    dispatcher_.multi().socket_action(socket, events, running_handles);
+    dispatcher_.complete();
+  }
+
+  void on_timeout() {
+    on_socket_ready(CURL_SOCKET_TIMEOUT, kNone);
+  }
+
+  size_t active() const {
+    return dispatcher_.active();
+  }
+
+  Callbacks callbacks;
+  Context context;
+  Options options;
+  Proxy proxy;
+
+private:
+  // https://curl.haxx.se/libcurl/c/CURLMOPT_SOCKETFUNCTION.html
+  static int socket_callback(CURL*, curl_socket_t socket, int what,
+                             void* userp, void*) {
+    auto& driver = *static_cast<Driver*>(userp);
+    if (driver.socket_handler_) {
+      int events = kNone;
+      if (what == CURL_POLL_IN || what == CURL_POLL_INOUT) {
+        events |= kRead;
+      }
+      if (what == CURL_POLL_OUT || what == CURL_POLL_INOUT) {
+        events |= kWrite;
+      }
+      driver.socket_handler_(socket, events);
+    }
+    return 0;
+  }
+
+  // https://curl.haxx.se/libcurl/c/CURLMOPT_TIMERFUNCTION.html
+  static int timer_callback(CURLM*, long timeout_ms, void* userp) {
+    auto& driver = *static_cast<Driver*>(userp);
+    if (driver.timer_handler_) {
+      if (timeout_ms < 0) {
+        driver.timer_handler_(std::nullopt);
+      } else {
+        driver.timer_handler_(std::chrono::milliseconds{timeout_ms});
+      }
+    }
+    return 0;
+  }
+
+  socket_handler_t socket_handler_;
+  timer_handler_t timer_handler_;
+  detail::curl::Dispatcher dispatcher_;
+};
+
+}  // namespace hypr
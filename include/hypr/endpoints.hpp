@@ -0,0 +1,275 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <hypr/detail/util.hpp>
+#include <hypr/models.hpp>
+#include <hypr/transport.hpp>
+
+namespace hypr {
+
+// Spreads requests over replicas of a service. Each request goes to the better
+// of two endpoints that are picked at random (power of two choices), which
+// avoids herding onto a single endpoint that merely looks best.
+//
+// Endpoints that fail repeatedly, with a transport error or a 5xx response,
+// are ejected for a while. Once the ejection time is over, a single request is
+// let through as a probe, and the endpoint is reinstated if it succeeds.
+// Otherwise it is ejected again for twice as long. If every endpoint is
+// ejected, requests go to the one that is closest to being probed.
+//
+// Thread-safe.
+class EndpointSet {
+public:
+  enum class Strategy {
+    LeastOutstanding,  // fewest requests in flight
+    PeakEwma,  // lowest latency, weighted by requests in flight
+  };
+
+  struct Status {
+    std::string url;
+    size_t outstanding = 0;
+    std::chrono::microseconds latency{0};  // peak EWMA
+    bool ejected = false;
+  };
+
+  // Throws std::invalid_argument if there are no endpoints.
+  explicit EndpointSet(const std::vector<std::string>& urls,
+                       const Strategy strategy = Strategy::PeakEwma)
+      : strategy_{strategy} {
+    if (urls.empty()) {
+      throw std::invalid_argument{"EndpointSet needs at least one endpoint"};
+    }
+    for (const auto& url : urls) {
+      endpoints_.emplace_back().url = url;
+    }
+  }
+
+  // Consecutive failures before an endpoint is ejected
+  size_t max_failures = 5;
+  std::chrono::milliseconds ejection_time{std::chrono::seconds{10}};
+  std::chrono::milliseconds max_ejection_time{std::chrono::minutes{5}};
+  // Time it takes for an old latency sample to lose most of its weight
+  std::chrono::milliseconds decay_time{std::chrono::seconds{10}};
+
+  // Returns the index of the endpoint to send a request to, which must be
+  // passed to `complete` afterwards.
+  size_t select() {
+    std::lock_guard lock{mutex_};
+
+    const auto now = Clock::now();
+
+    candidates_.clear();
+    for (size_t i = 0; i < endpoints_.size(); ++i) {
+      if (is_available(endpoints_[i], now)) {
+        candidates_.push_back(i);
+      }
+    }
+
+    size_t index = 0;
+    if (candidates_.empty()) {
+      index = closest_to_probe();
+    } else if (candidates_.size() == 1) {
+      index = candidates_.front();
+    } else {
+      std::uniform_int_distribution<size_t> distribution{
+          0, candidates_.size() - 1};
+      const auto a = candidates_[distribution(random_)];
+      auto b = candidates_[distribution(random_)];
+      while (b == a) {
+        b = candidates_[distribution(random_)];
+      }
+      index = score(endpoints_[a], now) <= score(endpoints_[b], now) ? a : b;
+    }
+
+    auto& endpoint = endpoints_[index];
+    ++endpoint.outstanding;
+    if (endpoint.ejected && endpoint.ejected_until <= now) {
+      endpoint.probing = true;
+    }
+    return index;
+  }
+
+  // Reports the outcome of a request that was sent to the endpoint.
+  void complete(const size_t index, const Response& response) {
+    std::lock_guard lock{mutex_};
+
+    const auto now = Clock::now();
+    auto& endpoint = endpoints_[index];
+    --endpoint.outstanding;
+
+    const auto code = response.error().code;
+    if (code == CURLE_ABORTED_BY_CALLBACK) {
+      endpoint.probing = false;
+      return;  // cancelled by the caller, which says nothing about the endpoint
+    }
+
+    const auto status = response.status_code();
+    const bool failed = code != CURLE_OK || (500 <= status && status < 600);
+    if (!failed) {
+      update_latency(endpoint, response.elapsed(), now);
+      endpoint.failures = 0;
+      endpoint.ejections = 0;
+      endpoint.ejected = false;
+      endpoint.probing = false;
+      return;
+    }
+
+    ++endpoint.failures;
+    if (endpoint.probing ||
+        (!endpoint.ejected && endpoint.failures >= max_failures)) {
+      eject(endpoint, now);
+    }
+  }
+
+  std::string url(const size_t index) const {
+    std::lock_guard lock{mutex_};
+    return endpoints_[index].url;
+  }
+
+  std::vector<Status> status() const {
+    std::lock_guard lock{mutex_};
+    std::vector<Status> status;
+    for (const auto& endpoint : endpoints_) {
+      status.push_back({endpoint.url, endpoint.outstanding,
+                        std::chrono::duration_cast<std::chrono::microseconds>(
+                            std::chrono::duration<double, std::micro>{
+                                endpoint.latency}),
+                        endpoint.ejected});
+    }
+    return status;
+  }
+
+  size_t size() const {
+    return endpoints_.size();
+  }
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  struct Endpoint {
+    std::string url;
+    size_t outstanding = 0;
+    double latency = 0;  // microseconds
+    Clock::time_point updated;
+    size_t failures = 0;
+    size_t ejections = 0;
+    bool ejected = false;
+    bool probing = false;
+    Clock::time_point ejected_until;
+  };
+
+  static bool is_available(const Endpoint& endpoint,
+                           const Clock::time_point now) {
+    if (!endpoint.ejected) {
+      return true;
+    }
+    // A single probe at a time
+    return endpoint.ejected_until <= now && !endpoint.probing;
+  }
+
+  size_t closest_to_probe() const {
+    const auto it = std::min_element(
+        endpoints_.begin(), endpoints_.end(),
+        [](const Endpoint& a, const Endpoint& b) {
+          return a.ejected_until < b.ejected_until;
+        });
+    return static_cast<size_t>(it - endpoints_.begin());
+  }
+
+  double score(const Endpoint& endpoint, const Clock::time_point now) const {
+    const auto outstanding = static_cast<double>(endpoint.outstanding);
+    switch (strategy_) {
+      case Strategy::LeastOutstanding:
+        break;
+      case Strategy::PeakEwma:
+        // Endpoints without samples are tried first
+        return decayed_latency(endpoint, now) * (outstanding + 1);
+    }
+    return outstanding;
+  }
+
+  double decay(const Endpoint& endpoint, const Clock::time_point now) const {
+    const auto elapsed =
+        std::chrono::duration<double, std::milli>{now - endpoint.updated};
+    const auto tau = std::chrono::duration<double, std::milli>{decay_time};
+    return tau.count() > 0 ? std::exp(-elapsed.count() / tau.count()) : 0;
+  }
+
+  double decayed_latency(const Endpoint& endpoint,
+                         const Clock::time_point now) const {
+    return endpoint.latency * decay(endpoint, now);
+  }
+
+  // Jumps up to slower samples at once, but only slowly forgets them
+  void update_latency(Endpoint& endpoint,
+                      const std::chrono::microseconds elapsed,
+                      const Clock::time_point now) {
+    const auto sample = static_cast<double>(elapsed.count());
+    if (sample > endpoint.latency) {
+      endpoint.latency = sample;
+    } else {
+      const auto weight = decay(endpoint, now);
+      endpoint.latency = endpoint.latency * weight + sample * (1 - weight);
+    }
+    endpoint.updated = now;
+  }
+
+  void eject(Endpoint& endpoint, const Clock::time_point now) {
+    const auto factor = 1LL << std::min<size_t>(endpoint.ejections, 16);
+    const auto duration = std::min<std::chrono::milliseconds>(
+        ejection_time * factor, max_ejection_time);
+    endpoint.ejected = true;
+    endpoint.probing = false;
+    endpoint.ejected_until = now + duration;
+    ++endpoint.ejections;
+  }
+
+  const Strategy strategy_;
+  std::vector<Endpoint> endpoints_;
+  std::vector<size_t> candidates_;
+  std::minstd_rand random_{std::random_device{}()};
+  mutable std::mutex mutex_;
+};
+
+// Sends each request to an endpoint of the set, replacing the scheme and
+// authority of its URL with the base URL of the endpoint.
+class BalancingTransport : public Transport {
+public:
+  explicit BalancingTransport(
+      std::shared_ptr<EndpointSet> endpoints,
+      std::shared_ptr<Transport> transport = std::make_shared<CurlTransport>())
+      : endpoints_{std::move(endpoints)}, transport_{std::move(transport)} {}
+
+  Response send(const Request& request,
+                const Callbacks& callbacks,
+                const Options& options,
+                const Proxy& proxy,
+                const Context& context) override {
+    const auto index = endpoints_->select();
+
+    auto balanced = request;
+    balanced.set_target(detail::rebase_url(hypp::to_string(request.target()),
+                                           endpoints_->url(index)));
+
+    auto response =
+        transport_->send(balanced, callbacks, options, proxy, context);
+    endpoints_->complete(index, response);
+    return response;
+  }
+
+private:
+  std::shared_ptr<EndpointSet> endpoints_;
+  std::shared_ptr<Transport> transport_;
+};
+
+}  // namespace hypr
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include <hypp/status.hpp>
+
+#include <hypr/detail/curl_interface.hpp>
+#include <hypr/detail/curl_session.hpp>
+#include <hypr/detail/event_stream.hpp>
+#include <hypr/models.hpp>
+
+namespace hypr {
+
+using ServerSentEvent = detail::ServerSentEvent;
+
+// Consumes a stream of server-sent events, dispatching each event as soon as
+// it arrives. Lost connections are reestablished after the retry interval,
+// sending the ID of the last event that was received.
+class EventSource {
+public:
+  // Returning false stops listening.
+  using handler_t = std::function<bool(const ServerSentEvent&)>;
+
+  // Blocks until the handler returns false, the context is cancelled, or the
+  // server tells us to stop by responding with something other than a stream.
+  Error listen(const Request& request, const handler_t& handler) {
+    // Streams are expected to stay open, and may be idle for a long time
+    auto stream_options = options;
+    stream_options.total_timeout = std::chrono::milliseconds{0};
+    stream_options.low_speed_limit = 0;
+
+    while (true) {
+      auto stream_request = request;
+      stream_request.set_header("Accept", "text/event-stream");
+      stream_request.set_header("Cache-Control", "no-cache");
+      if (!last_event_id.empty()) {
+        stream_request.set_header("Last-Event-ID", last_event_id);
+      }
+
+      enum class State { Connecting, Open, Rejected, Stopped };
+      auto state = State::Connecting;
+
+      detail::EventStreamParser parser{last_event_id};
+
+      auto stream_callbacks = callbacks;
+      stream_callbacks.write = [&](std::string_view data) {
+        if (state == State::Connecting) {
+          state = is_event_stream() ? State::Open : State::Rejected;
+        }
+        if (state == State::Open) {
+          parser.parse(data, [&](const ServerSentEvent& event) {
+            if (state == State::Open && !handler(event)) {
+              state = State::Stopped;
+            }
+          });
+        }
+        return state == State::Open;
+      };
+
+      const auto response = detail::curl::Interface::send(
+          stream_request, stream_callbacks, stream_options, proxy, context,
+          curl_session_);
+
+      last_event_id = parser.last_event_id();
+      if (const auto parser_retry = parser.retry()) {
+        retry = *parser_retry;
+      }
+
+      if (state == State::Stopped) {
+        return Error{};
+      }
+      if (context.cancelled()) {
+        return Error{CURLE_ABORTED_BY_CALLBACK};
+      }
+      if (!response.error()) {
+        if (response.status_code() == hypp::status::k204_No_Content) {
+          return Error{};
+        }
+        if (response.status_code() != hypp::status::k200_OK) {
+          return Error{CURLE_HTTP_RETURNED_ERROR};
+        }
+      }
+      if (state == State::Rejected) {
+        return Error{CURLE_HTTP_RETURNED_ERROR};
+      }
+
+      if (!wait(retry)) {
+        return Error{CURLE_ABORTED_BY_CALLBACK};
+      }
+    }
+  }
+
+  Callbacks callbacks;
+  Context context;
+  Options options;
+  Proxy proxy;
+
+  // Updated by the server through the stream
+  std::string last_event_id;
+  std::chrono::milliseconds retry{3000};
+
+private:
+  bool is_event_stream() const {
+    long code = 0;
+    curl_session_.getinfo(CURLINFO_RESPONSE_CODE, code);
+    if (code != hypp::status::k200_OK) {
+      return false;
+    }
+
+    char* content_type = nullptr;
+    curl_session_.getinfo(CURLINFO_CONTENT_TYPE, content_type);
+    constexpr std::string_view media_type = "text/event-stream";
+    return content_type &&
+           detail::equals_case_insensitive(
+               std::string_view{content_type}.substr(0, media_type.size()),
+               media_type);
+  }
+
+  // Returns false if the context is cancelled or expires while waiting
+  bool wait(const std::chrono::milliseconds duration) const {
+    constexpr auto interval = std::chrono::milliseconds{100};
+    const auto until = std::chrono::steady_clock::now() + duration;
+    while (std::chrono::steady_clock::now() < until) {
+      if (context.cancelled() || context.expired()) {
+        return false;
+      }
+      std::this_thread::sleep_for(interval);
+    }
+    return !context.cancelled() && !context.expired();
+  }
+
+  detail::curl::Session curl_session_;
+};
+
+}  // namespace hypr
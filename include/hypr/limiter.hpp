@@ -0,0 +1,270 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <hypr/models.hpp>
+#include <hypr/transport.hpp>
+
+namespace hypr {
+
+// Limits the number of requests in flight to each host, and adapts the limit
+// to how the host copes with them. While latency stays close to what it is
+// when the host is not busy, the limit grows. Once requests start to queue up
+// at the host and latency rises, the limit shrinks in proportion (gradient),
+// and errors shrink it by a fixed ratio.
+//
+// Requests over the limit wait in line, and fail with CURLE_OPERATION_TIMEDOUT
+// if the line is too long or they wait for too long. This sheds load early,
+// rather than piling it onto a host that is already struggling.
+//
+// Thread-safe.
+class ConcurrencyLimiter {
+public:
+  struct Status {
+    std::string host;
+    size_t limit = 0;
+    size_t in_flight = 0;
+    size_t queued = 0;
+    std::chrono::microseconds latency{0};  // recent average
+    std::chrono::microseconds baseline{0};  // without load
+  };
+
+  size_t initial_limit = 20;
+  size_t min_limit = 1;
+  size_t max_limit = 1000;
+  // How far latency may rise over the baseline before the limit shrinks
+  double tolerance = 1.5;
+  // Time it takes for the baseline to catch up with a lasting rise in latency
+  std::chrono::milliseconds baseline_time{std::chrono::minutes{1}};
+  // The limit is multiplied by this after an error, 429 or 5xx response
+  double backoff = 0.9;
+  // Requests that may wait for a free slot, per host
+  size_t max_queued = 100;
+  std::chrono::milliseconds max_queue_time{std::chrono::seconds{1}};
+
+  // Waits for a free slot. If this succeeds, `release` must be called once the
+  // request is complete. Otherwise, returns the error that the request should
+  // fail with.
+  CURLcode acquire(const std::string& host, const Context& context) {
+    std::unique_lock lock{mutex_};
+    auto& state = get(host);
+
+    if (!state.queued && state.in_flight < limit_of(state)) {
+      ++state.in_flight;
+      return CURLE_OK;
+    }
+    if (state.queued >= max_queued) {
+      return CURLE_OPERATION_TIMEDOUT;
+    }
+
+    constexpr auto interval = std::chrono::milliseconds{100};
+    const auto deadline = Clock::now() + max_queue_time;
+
+    ++state.queued;
+    auto code = CURLE_OK;
+    while (state.in_flight >= limit_of(state)) {
+      // Cancellation is not signalled, so it has to be checked now and then
+      if (context.cancelled()) {
+        code = CURLE_ABORTED_BY_CALLBACK;
+        break;
+      }
+      const auto now = Clock::now();
+      if (context.expired() || now >= deadline) {
+        code = CURLE_OPERATION_TIMEDOUT;
+        break;
+      }
+      auto timeout = std::min<Clock::duration>(interval, deadline - now);
+      if (const auto remaining = context.remaining()) {
+        timeout = std::min<Clock::duration>(timeout, *remaining);
+      }
+      condition_.wait_for(lock, timeout);
+    }
+    --state.queued;
+
+    if (code == CURLE_OK) {
+      ++state.in_flight;
+    }
+    return code;
+  }
+
+  void release(const std::string& host, const Response& response) {
+    {
+      std::lock_guard lock{mutex_};
+      auto& state = get(host);
+      update(state, response);
+      --state.in_flight;
+    }
+    condition_.notify_all();
+  }
+
+  std::vector<Status> status() const {
+    std::lock_guard lock{mutex_};
+    std::vector<Status> status;
+    for (const auto& [host, state] : hosts_) {
+      status.push_back({host, limit_of(state), state.in_flight, state.queued,
+                        to_microseconds(state.latency),
+                        to_microseconds(state.baseline)});
+    }
+    return status;
+  }
+
+  // Idle hosts that were not seen for the longest time are forgotten first
+  static constexpr size_t kMaxHosts = 256;
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  struct State {
+    double limit = 0;
+    size_t in_flight = 0;
+    size_t queued = 0;
+    double latency = 0;  // microseconds
+    double baseline = 0;
+    Clock::time_point updated;
+    uint64_t used = 0;
+  };
+
+  State& get(const std::string& host) {
+    auto it = hosts_.find(host);
+    if (it == hosts_.end()) {
+      if (hosts_.size() >= kMaxHosts) {
+        evict();
+      }
+      it = hosts_.try_emplace(host).first;
+      it->second.limit = static_cast<double>(
+          std::clamp(initial_limit, min_limit, max_limit));
+    }
+    it->second.used = ++clock_;
+    return it->second;
+  }
+
+  // Hosts with requests in flight or in line are kept, even if that means
+  // going over the maximum for a while
+  void evict() {
+    auto oldest = hosts_.end();
+    for (auto it = hosts_.begin(); it != hosts_.end(); ++it) {
+      const auto& state = it->second;
+      if (!state.in_flight && !state.queued &&
+          (oldest == hosts_.end() || state.used < oldest->second.used)) {
+        oldest = it;
+      }
+    }
+    if (oldest != hosts_.end()) {
+      hosts_.erase(oldest);
+    }
+  }
+
+  size_t limit_of(const State& state) const {
+    return std::max(min_limit, static_cast<size_t>(state.limit));
+  }
+
+  void update(State& state, const Response& response) const {
+    const auto code = response.error().code;
+    if (code == CURLE_ABORTED_BY_CALLBACK) {
+      return;  // cancelled by the caller, which says nothing about the host
+    }
+
+    const auto min = static_cast<double>(min_limit);
+    const auto max = static_cast<double>(max_limit);
+
+    const auto status = response.status_code();
+    if (code != CURLE_OK || status == hypp::status::k429_Too_Many_Requests ||
+        (500 <= status && status < 600)) {
+      state.limit = std::clamp(state.limit * backoff, min, max);
+      return;
+    }
+
+    const auto sample = static_cast<double>(response.elapsed().count());
+    if (sample <= 0) {
+      return;
+    }
+
+    // The recent average follows the last ten or so samples. The baseline
+    // drops with it at once, but only slowly rises over time, so that it
+    // tracks the latency of the host when it is not busy. Rising per sample
+    // would let it catch up with the congestion that it is meant to detect.
+    constexpr double recent_weight = 0.1;
+    const auto now = Clock::now();
+    if (!state.latency) {
+      state.latency = state.baseline = sample;
+    } else {
+      state.latency += (sample - state.latency) * recent_weight;
+      const std::chrono::duration<double> elapsed = now - state.updated;
+      const std::chrono::duration<double> tau = baseline_time;
+      const auto drift =
+          tau.count() > 0 ? 1 - std::exp(-elapsed.count() / tau.count()) : 1;
+      state.baseline += (state.latency - state.baseline) * drift;
+      state.baseline = std::min(state.baseline, state.latency);
+    }
+    state.updated = now;
+
+    // Growth is allowed by as many requests as would queue up at the host
+    // without raising latency much, which is guessed to be the square root of
+    // the limit.
+    const auto gradient =
+        std::clamp(tolerance * state.baseline / state.latency, 0.5, 1.0);
+    const auto target = state.limit * gradient + std::sqrt(state.limit);
+
+    // A limit that is not used up says nothing about whether it could be higher
+    if (target > state.limit && state.in_flight * 2 < state.limit) {
+      return;
+    }
+
+    constexpr double smoothing = 0.2;
+    state.limit =
+        std::clamp(state.limit + (target - state.limit) * smoothing, min, max);
+  }
+
+  static std::chrono::microseconds to_microseconds(const double value) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::duration<double, std::micro>{value});
+  }
+
+  mutable std::mutex mutex_;
+  std::condition_variable condition_;
+  std::unordered_map<std::string, State> hosts_;
+  uint64_t clock_ = 0;
+};
+
+// Sends requests through another transport, keeping the number of requests
+// in flight to each host within the limits of a shared limiter.
+class LimitingTransport : public Transport {
+public:
+  explicit LimitingTransport(
+      std::shared_ptr<ConcurrencyLimiter> limiter,
+      std::shared_ptr<Transport> transport = std::make_shared<CurlTransport>())
+      : limiter_{std::move(limiter)}, transport_{std::move(transport)} {}
+
+  Response send(const Request& request,
+                const Callbacks& callbacks,
+                const Options& options,
+                const Proxy& proxy,
+                const Context& context) override {
+    const auto& authority = request.target().uri.authority;
+    const auto host = authority ? authority->host : std::string{};
+
+    if (const auto code = limiter_->acquire(host, context); code != CURLE_OK) {
+      return Response(code);
+    }
+    auto response =
+        transport_->send(request, callbacks, options, proxy, context);
+    limiter_->release(host, response);
+    return response;
+  }
+
+private:
+  std::shared_ptr<ConcurrencyLimiter> limiter_;
+  std::shared_ptr<Transport> transport_;
+};
+
+}  // namespace hypr
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+
+#include <hypr/detail/memory_budget.hpp>
+
+// Bounds the memory that is used by response bodies across the process.
+// Transfers are paused rather than failed when the budget runs out, and
+// continue as soon as earlier responses are destroyed. Streamed responses
+// are not kept in memory, so they do not count towards the budget.
+namespace hypr::memory {
+
+using Stats = detail::MemoryStats;
+
+// 0 means no limit, which is the default.
+inline void set_budget(const size_t bytes) {
+  detail::MemoryBudget::instance().set_limit(bytes);
+}
+
+inline Stats stats() {
+  return detail::MemoryBudget::instance().stats();
+}
+
+}  // namespace hypr::memory
@@ -1,10 +1,10 @@
 #pragma once
 
 #include <chrono>
+#include <cstdint>
 #include <string>
 #include <string_view>
 
-#include <hypp/detail/uri.hpp>
 #include <hypp/parser/method.hpp>
 #include <hypp/parser/request.hpp>
 #include <hypp/header.hpp>
@@ -17,20 +17,54 @@
 #include <hypr/detail/models.hpp>
 #include <hypr/detail/util.hpp>
 
+namespace hypr::detail::curl {
+class Interface;
+}  // namespace hypr::detail::curl
+
 namespace hypr {
 
 using StatusCode = hypp::status::code_t;
 using Url = hypp::Uri;
 
 using Callbacks = detail::Callbacks;
+using CancellationToken = detail::CancellationToken;
+using Context = detail::Context;
+using DigestAlgorithm = detail::DigestAlgorithm;
 using Error = detail::Error;
 using Headers = detail::Headers;
+using Priority = detail::Priority;
 
 struct Options {
   bool allow_redirects = true;
   bool certificate_revocation = true;
   int max_redirects = 30;
   std::chrono::seconds timeout{60};
+  std::chrono::milliseconds total_timeout{0};  // 0 means no limit
+  int64_t low_speed_limit = 1024;  // bytes per second over `timeout`
+  // Computes a digest of the response body while it is received. The transfer
+  // fails with CURLE_BAD_CONTENT_ENCODING if it does not match the expected
+  // value (in hex), or if that is empty, the Repr-Digest or Digest header of
+  // a 200 response. Partial responses are not verified.
+  DigestAlgorithm digest = DigestAlgorithm::None;
+  std::string expected_digest;
+  // Negotiated over TLS, falling back to HTTP/1.1. Lets transfers of a client
+  // share a connection, where request priorities become stream weights.
+  bool http2 = false;
+  // 0 uses libcurl's defaults (16 KiB and 64 KiB). With `adaptive_buffers`,
+  // buffers grow per host to match the throughput of earlier transfers.
+  size_t buffer_size = 0;
+  size_t upload_buffer_size = 0;
+  bool adaptive_buffers = false;
+  // Maximum number of idle connections that are kept open
+  size_t max_connections = 5;
+  bool tcp_nodelay = true;
+  bool tcp_keepalive = false;
+  std::chrono::seconds tcp_keepalive_idle{60};
+  std::chrono::seconds tcp_keepalive_interval{60};
+  // Connects to a Unix domain socket instead of the host in the URL. On Linux,
+  // abstract sockets are used if `abstract_unix_socket` is set.
+  std::string unix_socket;
+  bool abstract_unix_socket = false;
   bool verbose = false;
   bool verify_certificate = true;
 };
@@ -51,13 +85,23 @@ public:
   Params() = default;
   Params(const std::initializer_list<Param>& params) : params_{params} {}
 
+  // Names and values are percent-encoded directly into a single allocation.
   std::string to_string() const {
+    size_t size = 0;
+    for (const auto& [name, value] : params_) {
+      size += detail::percent_encoded_size(name) +
+              detail::percent_encoded_size(value) + 2;  // '=' and '&'
+    }
+
     std::string str;
+    str.reserve(size);
     for (const auto& [name, value] : params_) {
       if (!str.empty()) {
         str.push_back('&');
       }
-      str += name + '=' + hypp::detail::uri::encode(value);
+      detail::percent_encode(name, str);
+      str.push_back('=');
+      detail::percent_encode(value, str);
     }
     return str;
   }
@@ -83,7 +127,7 @@ private:
 class Query {
 public:
   Query() = default;
-  Query(const std::string_view str) : query_{hypp::detail::uri::encode(str)} {}
+  Query(const std::string_view str) : query_{detail::percent_encode(str)} {}
   Query(const std::initializer_list<Param>& params) : Query{Params{params}} {}
   Query(const Params& params) : query_{params.to_string()} {}
 
@@ -121,6 +165,59 @@ private:
   std::string media_type_;
 };
 
+class Multipart {
+public:
+  using reader_t = detail::MimePart::reader_t;
+
+  Multipart() = default;
+  Multipart(const std::initializer_list<Param>& params) {
+    for (const auto& [name, value] : params) {
+      add(name, value);
+    }
+  }
+
+  void add(const std::string_view name, const std::string_view value,
+           const std::string_view media_type = {}) {
+    auto& part = parts_.emplace_back();
+    part.name = name;
+    part.data = value;
+    part.media_type = media_type;
+  }
+
+  // The file is read while the request is being sent. Its name is used as the
+  // filename unless another one is given.
+  void add_file(const std::string_view name, const std::string_view path,
+                const std::string_view media_type = {},
+                const std::string_view filename = {}) {
+    auto& part = parts_.emplace_back();
+    part.name = name;
+    part.path = path;
+    part.media_type = media_type;
+    part.filename = filename;
+  }
+
+  // The reader is called while the request is being sent. If the size is not
+  // known beforehand, the request is sent with chunked transfer encoding.
+  void add_reader(const std::string_view name, reader_t reader,
+                  const std::optional<uint64_t> size = std::nullopt,
+                  const std::string_view media_type = {},
+                  const std::string_view filename = {}) {
+    auto& part = parts_.emplace_back();
+    part.name = name;
+    part.reader = std::move(reader);
+    part.size = size;
+    part.media_type = media_type;
+    part.filename = filename;
+  }
+
+  const std::vector<detail::MimePart>& parts() const {
+    return parts_;
+  }
+
+private:
+  std::vector<detail::MimePart> parts_;
+};
+
 class Request {
 public:
   Request() {
@@ -183,15 +280,33 @@ public:
     request_.headers = headers;
   }
 
+  // Asynchronous clients send requests of higher priority first
+  Priority priority() const {
+    return request_.priority;
+  }
+  void set_priority(const Priority priority) {
+    request_.priority = priority;
+  }
+
   const std::string& body() const {
     return request_.body;
   }
+  const std::vector<detail::MimePart>& multipart() const {
+    return request_.multipart;
+  }
   void set_body(const Body& body) {
+    request_.multipart.clear();
     request_.body = body.to_string();
     if (header("content-type").empty() && !body.media_type().empty()) {
       set_header("Content-Type", body.media_type());
     }
   }
+  // libcurl sets the Content-Type header, along with the boundary
+  void set_body(const Multipart& multipart) {
+    request_.body.clear();
+    request_.headers.erase("Content-Type");
+    request_.multipart = multipart.parts();
+  }
 
 private:
   detail::Request request_;
@@ -200,11 +315,14 @@ private:
 class Response {
 public:
   Response() = default;
-  Response(detail::Response&& response) : response_{response} {}
+  Response(detail::Response&& response) : response_{std::move(response)} {}
 
   StatusCode status_code() const {
     return response_.start_line.code;
   }
+  void set_status_code(const StatusCode code) {
+    response_.start_line.code = code;
+  }
   StatusCode status_class() const {
     return hypp::status::to_class(response_.start_line.code);
   }
@@ -215,6 +333,9 @@ public:
   std::string url() const {
     return response_.url;
   }
+  void set_url(const std::string_view url) {
+    response_.url = url;
+  }
 
   std::string header(const std::string_view name) const {
     const auto it = response_.headers.find(std::string{name});
@@ -223,6 +344,12 @@ public:
   const Headers& headers() const {
     return response_.headers;
   }
+  void set_header(const std::string_view name, const std::string_view value) {
+    response_.headers[std::string{name}] = value;
+  }
+  void set_headers(const Headers& headers) {
+    response_.headers = headers;
+  }
 
   std::string& body() {
     return response_.body;
@@ -230,16 +357,29 @@ public:
   const std::string& body() const {
     return response_.body;
   }
+  void set_body(std::string body) {
+    response_.body = std::move(body);
+  }
 
   std::chrono::microseconds elapsed() const {
     return response_.elapsed;
   }
+  void set_elapsed(const std::chrono::microseconds elapsed) {
+    response_.elapsed = elapsed;
+  }
+
+  // Digest of the body in hex, if one was requested
+  const std::string& digest() const {
+    return response_.digest;
+  }
 
   const Error& error() const {
     return response_.error;
   }
 
 private:
+  friend class detail::curl::Interface;
+
   detail::Response response_;
 };
 
@@ -0,0 +1,181 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+
+#include <hypr/detail/link.hpp>
+#include <hypr/detail/util.hpp>
+#include <hypr/models.hpp>
+#include <hypr/session.hpp>
+#include <hypr/transport.hpp>
+
+namespace hypr {
+
+// Follows the `Link: <...>; rel="next"` header of a page, resolving the target
+// against the URL of the page. Ends the walk if there is no such link.
+inline std::optional<Request> next_link(const Request& request,
+                                        const Response& response) {
+  const auto target = detail::find_link(response.header("Link"), "next");
+  if (!target) {
+    return std::nullopt;
+  }
+  const auto base = !response.url().empty()
+                        ? response.url()
+                        : hypp::to_string(request.target());
+  auto next = request;
+  if (!next.set_target(detail::resolve_url(base, *target))) {
+    return std::nullopt;
+  }
+  return next;
+}
+
+// Walks a paginated collection, fetching pages on a background thread while
+// the caller is busy with the ones before them. Since the address of a page is
+// only known once the previous one has arrived, pages are still requested one
+// after another, but the caller does not have to wait for the round trip
+// unless it is faster than the server.
+//
+//   hypr::Paginator pages;
+//   pages.start(request);
+//   while (auto page = pages.next()) { ... }
+//
+// Settings must not be changed after `start`.
+class Paginator {
+public:
+  // Returns the request for the page after the given one, or nothing if it is
+  // the last page.
+  using next_t =
+      std::function<std::optional<Request>(const Request&, const Response&)>;
+
+  ~Paginator() {
+    stop();
+  }
+
+  void start(const Request& request) {
+    stop();
+
+    fetch_context_ = context.child();
+    stopping_ = false;
+    done_ = false;
+    pages_.clear();
+
+    thread_ = std::thread{[this, request]() { fetch(request); }};
+  }
+
+  // Returns the next page, waiting for it if it has not arrived yet. The walk
+  // ends after a page that failed with an error, which is still returned.
+  std::optional<Response> next() {
+    std::unique_lock lock{mutex_};
+    condition_.wait(lock, [this]() { return !pages_.empty() || done_; });
+    if (pages_.empty()) {
+      return std::nullopt;
+    }
+    auto page = std::move(pages_.front());
+    pages_.pop_front();
+    lock.unlock();
+    condition_.notify_all();
+    return page;
+  }
+
+  // Cancels pages that are in flight, and drops the ones that were fetched
+  // ahead.
+  void stop() {
+    if (!thread_.joinable()) {
+      return;
+    }
+    {
+      std::lock_guard lock{mutex_};
+      stopping_ = true;
+    }
+    fetch_context_.cancellation.cancel();
+    condition_.notify_all();
+    thread_.join();
+
+    std::lock_guard lock{mutex_};
+    pages_.clear();
+  }
+
+  // Pages that may be fetched ahead of the caller, 0 means 1
+  size_t prefetch = 2;
+
+  // Finds the next page. Follows Link headers by default.
+  next_t next_page = next_link;
+
+  // Sends requests over the network by default. Must not be shared with other
+  // threads unless it is thread-safe.
+  std::shared_ptr<Transport> transport;
+
+  Callbacks callbacks;
+  Context context;
+  Options options;
+  Proxy proxy;
+
+private:
+  void fetch(Request request) {
+    Session session;
+    session.set_transport(transport);
+    session.callbacks = callbacks;
+    session.context = fetch_context_;
+    session.options = options;
+    session.proxy = proxy;
+
+    const auto limit = std::max<size_t>(prefetch, 1);
+
+    while (true) {
+      {
+        std::unique_lock lock{mutex_};
+        condition_.wait(lock, [&]() {
+          return stopping_ || pages_.size() < limit;
+        });
+        if (stopping_) {
+          break;
+        }
+      }
+
+      auto response = session.send(request);
+
+      std::optional<Request> next;
+      if (!response.error() && next_page) {
+        next = next_page(request, response);
+      }
+
+      {
+        std::lock_guard lock{mutex_};
+        if (stopping_) {
+          break;
+        }
+        pages_.push_back(std::move(response));
+      }
+      condition_.notify_all();
+
+      if (!next) {
+        break;
+      }
+      request = std::move(*next);
+    }
+
+    {
+      std::lock_guard lock{mutex_};
+      done_ = true;
+    }
+    condition_.notify_all();
+  }
+
+  Context fetch_context_;
+  std::thread thread_;
+
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  std::deque<Response> pages_;
+  bool stopping_ = false;
+  bool done_ = true;  // until started
+};
+
+}  // namespace hypr
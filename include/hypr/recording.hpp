@@ -0,0 +1,261 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <hypp/status.hpp>
+
+#include <hypr/client.hpp>
+#include <hypr/detail/recording.hpp>
+#include <hypr/models.hpp>
+#include <hypr/transport.hpp>
+
+namespace hypr {
+
+// A request that was sent, the response that it got, and when it was sent
+// relative to the start of the recording.
+using Exchange = detail::recording::Exchange;
+
+// Replaces the values of headers that carry credentials, so that they are not
+// written to a recording.
+inline void redact_credentials(Exchange& exchange) {
+  const auto redact = [](const Headers& headers) {
+    auto redacted = headers;
+    for (const auto name :
+         {"Authorization", "Proxy-Authorization", "Cookie", "Set-Cookie"}) {
+      if (const auto it = redacted.find(name); it != redacted.end()) {
+        it->second = "REDACTED";
+      }
+    }
+    return redacted;
+  };
+  exchange.request.set_headers(redact(exchange.request.headers()));
+  exchange.response.set_headers(redact(exchange.response.headers()));
+}
+
+// Writes exchanges to a file in a compact binary format. Thread-safe, so that
+// a single recorder can be shared by many sessions.
+//
+// Recordings are not encrypted. Credentials in headers are redacted by
+// default, but those in URLs and bodies are written as they are.
+class Recorder {
+public:
+  using redact_t = std::function<void(Exchange&)>;
+
+  explicit Recorder(const std::string& path)
+      : stream_{path, std::ios::binary | std::ios::trunc},
+        start_{std::chrono::steady_clock::now()} {
+    detail::recording::Writer{stream_}.write_signature();
+  }
+
+  bool is_open() const {
+    return stream_.is_open() && stream_.good();
+  }
+
+  void record(const Request& request, const Response& response,
+              const std::chrono::steady_clock::time_point sent) {
+    Exchange exchange;
+    exchange.offset =
+        std::chrono::duration_cast<std::chrono::microseconds>(sent - start_);
+    exchange.request = request;
+    exchange.response = response;
+    if (redact) {
+      redact(exchange);
+    }
+
+    std::lock_guard lock{mutex_};
+    detail::recording::Writer{stream_}.write(exchange);
+  }
+
+  void flush() {
+    std::lock_guard lock{mutex_};
+    stream_.flush();
+  }
+
+  // Called with each exchange before it is written. May be replaced to redact
+  // more, or unset to keep everything.
+  redact_t redact = redact_credentials;
+
+private:
+  std::mutex mutex_;
+  std::ofstream stream_;
+  const std::chrono::steady_clock::time_point start_;
+};
+
+// Reads all exchanges of a recording. Returns false if the file cannot be
+// opened or is not a recording. A truncated recording is read up to its last
+// complete exchange.
+inline bool read_recording(const std::string& path,
+                           std::vector<Exchange>& exchanges) {
+  std::ifstream stream{path, std::ios::binary};
+  detail::recording::Reader reader{stream};
+  if (!stream.is_open() || !reader.read_signature()) {
+    return false;
+  }
+  while (auto exchange = reader.read()) {
+    exchanges.push_back(std::move(*exchange));
+  }
+  return true;
+}
+
+// Sends requests through another transport, and records them along with their
+// responses. Bodies of streamed responses are not kept, so they are recorded
+// as empty.
+class RecordingTransport : public Transport {
+public:
+  explicit RecordingTransport(
+      std::shared_ptr<Recorder> recorder,
+      std::shared_ptr<Transport> transport = std::make_shared<CurlTransport>())
+      : recorder_{std::move(recorder)}, transport_{std::move(transport)} {}
+
+  Response send(const Request& request,
+                const Callbacks& callbacks,
+                const Options& options,
+                const Proxy& proxy,
+                const Context& context) override {
+    const auto sent = std::chrono::steady_clock::now();
+    auto response =
+        transport_->send(request, callbacks, options, proxy, context);
+    recorder_->record(request, response, sent);
+    return response;
+  }
+
+private:
+  std::shared_ptr<Recorder> recorder_;
+  std::shared_ptr<Transport> transport_;
+};
+
+// Stands in for the servers of a recording, answering each request with a
+// recorded response to the same method and target. Requests that were made
+// more than once get their responses in the original order, starting over
+// after the last one. Anything else gets a 404. Thread-safe.
+class ReplayTransport : public Transport {
+public:
+  explicit ReplayTransport(const std::vector<Exchange>& exchanges) {
+    for (const auto& exchange : exchanges) {
+      responses_[make_key(exchange.request)].responses.push_back(
+          exchange.response);
+    }
+  }
+
+  Response send(const Request& request,
+                const Callbacks& callbacks,
+                const Options& options,
+                const Proxy& proxy,
+                const Context& context) override {
+    return transport_.send(request, callbacks, options, proxy, context);
+  }
+
+private:
+  static std::string make_key(const Request& request) {
+    return request.method() + ' ' + hypp::to_string(request.target());
+  }
+
+  Response find(const Request& request) {
+    std::lock_guard lock{mutex_};
+    const auto it = responses_.find(make_key(request));
+    if (it == responses_.end()) {
+      Response response;
+      response.set_status_code(hypp::status::k404_Not_Found);
+      return response;
+    }
+    auto& [responses, next] = it->second;
+    const auto& response = responses[next];
+    next = (next + 1) % responses.size();
+    return response;
+  }
+
+  struct Responses {
+    std::vector<Response> responses;
+    size_t next = 0;
+  };
+
+  std::mutex mutex_;
+  std::map<std::string, Responses> responses_;
+  InMemoryTransport transport_{
+      [this](const Request& request) { return find(request); }};
+};
+
+// Sends the requests of a recording again with the same gaps between them,
+// e.g. against a local server. Requests are sent on schedule even if earlier
+// ones are still in flight, so the original load is reproduced.
+class Replayer {
+public:
+  using handler_t = std::function<void(const Exchange&, Response&&)>;
+
+  // Blocks until every request is complete.
+  void replay(const std::vector<Exchange>& exchanges,
+              const handler_t& handler = nullptr) {
+    if (exchanges.empty()) {
+      return;
+    }
+
+    using Clock = std::chrono::steady_clock;
+
+    const auto first = exchanges.front().offset;
+    const auto start = Clock::now();
+    size_t in_flight = 0;
+
+    for (size_t index = 0; index < exchanges.size() || in_flight;) {
+      const auto now = Clock::now();
+
+      for (; index < exchanges.size(); ++index) {
+        const auto& exchange = exchanges[index];
+        const auto due = start + std::chrono::duration_cast<Clock::duration>(
+            (exchange.offset - first) / speed);
+        if (due > now) {
+          break;
+        }
+        ++in_flight;
+        client.send_async(rebase(exchange.request),
+                          [&, index](Response&& response) {
+                            --in_flight;
+                            if (handler) {
+                              handler(exchanges[index], std::move(response));
+                            }
+                          });
+      }
+
+      auto timeout = std::chrono::milliseconds{100};
+      if (index < exchanges.size()) {
+        const auto due = start + std::chrono::duration_cast<Clock::duration>(
+            (exchanges[index].offset - first) / speed);
+        timeout = std::min(timeout,
+            std::chrono::duration_cast<std::chrono::milliseconds>(due - now));
+      }
+      client.poll(std::max(timeout, std::chrono::milliseconds{0}));
+    }
+  }
+
+  // Replaces the scheme and authority of recorded URLs, if set. For example,
+  // "http://localhost:8080" sends "https://example.com/a?b" to
+  // "http://localhost:8080/a?b".
+  std::string base_url;
+
+  // Higher values replay faster, e.g. 2.0 takes half the original time.
+  double speed = 1.0;
+
+  Client client;
+
+private:
+  Request rebase(const Request& request) const {
+    if (base_url.empty()) {
+      return request;
+    }
+    auto rebased = request;
+    rebased.set_target(
+        detail::rebase_url(hypp::to_string(request.target()), base_url));
+    return rebased;
+  }
+};
+
+}  // namespace hypr
@@ -1,14 +1,42 @@
 #pragma once
 
+#include <memory>
 #include <string_view>
+#include <utility>
 
-#include <hypr/detail/curl_interface.hpp>
 #include <hypr/models.hpp>
+#include <hypr/transport.hpp>
 
 namespace hypr {
 
+// Sessions are move-only, like the easy handle of their default transport,
+// which must not be used by two sessions at once. Moved-from sessions get a
+// new default transport, so they can still be used.
 class Session {
 public:
+  Session() = default;
+  Session(const Session&) = delete;
+  Session(Session&& other)
+      : callbacks{std::move(other.callbacks)},
+        context{std::move(other.context)},
+        options{std::move(other.options)},
+        proxy{std::move(other.proxy)},
+        transport_{std::exchange(other.transport_,
+                                 std::make_shared<CurlTransport>())} {}
+
+  Session& operator=(const Session&) = delete;
+  Session& operator=(Session&& other) {
+    if (this != &other) {
+      callbacks = std::move(other.callbacks);
+      context = std::move(other.context);
+      options = std::move(other.options);
+      proxy = std::move(other.proxy);
+      transport_ = std::exchange(other.transport_,
+                                 std::make_shared<CurlTransport>());
+    }
+    return *this;
+  }
+
   template <typename... Ts>
   Response request(const std::string_view method,
                    const std::string_view target,
@@ -24,11 +52,26 @@ public:
   }
 
   Response send(const Request& request) {
-    return detail::curl::Interface::send(
-        request, callbacks, options, proxy, curl_session_);
+    return transport_->send(request, callbacks, options, proxy, context);
+  }
+
+  // Receives the response into an earlier one, reusing the capacity of its
+  // body and URL, and the map nodes of its headers. Header names and values
+  // are still allocated anew. Meant for sending similar requests over and
+  // over.
+  void send_into(const Request& request, Response& response) {
+    transport_->send_into(request, callbacks, options, proxy, context,
+                          response);
+  }
+
+  // Transports can be shared between sessions if they are thread-safe.
+  void set_transport(std::shared_ptr<Transport> transport) {
+    transport_ = transport ? std::move(transport)
+                           : std::make_shared<CurlTransport>();
   }
 
   Callbacks callbacks;
+  Context context;
   Options options;
   Proxy proxy;
 
@@ -45,11 +88,19 @@ private:
     request.set_body(body);
   }
 
+  void set_option(const Multipart& multipart, Request& request) {
+    request.set_body(multipart);
+  }
+
   void set_option(const Proxy& proxy, Request&) {
     this->proxy = proxy;
   }
 
-  detail::curl::Session curl_session_;
+  void set_option(const Context& context, Request&) {
+    this->context = context;
+  }
+
+  std::shared_ptr<Transport> transport_ = std::make_shared<CurlTransport>();
 };
 
 }  // namespace hypr
@@ -0,0 +1,205 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <hypr/detail/curl_dispatcher.hpp>
+#include <hypr/detail/curl_share.hpp>
+#include <hypr/models.hpp>
+
+namespace hypr {
+
+// Spreads requests over several event loops, each running on its own thread
+// with its own multi handle and connection cache. Requests to the same host
+// go to the same shard so that connections can be reused, and shards that
+// run out of work take queued requests from busier ones. DNS and TLS session
+// caches are shared between all shards.
+//
+// `send_async` can be called from any thread. Handlers are called on the
+// thread of the shard that ran the transfer.
+class ShardedClient {
+public:
+  using handler_t = std::function<void(Response&&)>;
+
+  explicit ShardedClient(size_t shard_count = 0, bool pin_threads = false) {
+    if (!shard_count) {
+      shard_count = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+
+    cache_.init(CURL_LOCK_DATA_DNS, CURL_LOCK_DATA_SSL_SESSION);
+
+    for (size_t i = 0; i < shard_count; ++i) {
+      auto shard = std::make_unique<Shard>();
+      shard->dispatcher.init();
+      shard->dispatcher.set_share(cache_.get() ? &cache_ : nullptr);
+      shards_.push_back(std::move(shard));
+    }
+    for (size_t i = 0; i < shard_count; ++i) {
+      shards_[i]->thread = std::thread{[this, i]() { run(i); }};
+      if (pin_threads) {
+        pin_thread(shards_[i]->thread, i);
+      }
+    }
+  }
+
+  ShardedClient(const ShardedClient&) = delete;
+  ShardedClient& operator=(const ShardedClient&) = delete;
+
+  // Waits for the threads to finish. Requests that are still queued or in
+  // flight are dropped without calling their handlers.
+  ~ShardedClient() {
+    stopped_ = true;
+    for (auto& shard : shards_) {
+      shard->dispatcher.multi().wakeup();
+    }
+    for (auto& shard : shards_) {
+      if (shard->thread.joinable()) {
+        shard->thread.join();
+      }
+    }
+  }
+
+  void send_async(const Request& request, handler_t handler) {
+    auto& shard = *shards_[shard_index(request)];
+    size_t backlog = 0;
+    {
+      std::lock_guard lock{shard.mutex};
+      shard.queue.push_back({request, callbacks, options, proxy, context,
+                             std::move(handler)});
+      backlog = shard.queue.size();
+    }
+    shard.dispatcher.multi().wakeup();
+
+    // Let an idle shard know that there is work to take
+    if (backlog > 1) {
+      for (auto& other : shards_) {
+        if (other.get() != &shard && other->idle) {
+          other->dispatcher.multi().wakeup();
+          break;
+        }
+      }
+    }
+  }
+
+  size_t shard_count() const {
+    return shards_.size();
+  }
+
+  Callbacks callbacks;
+  Context context;
+  Options options;
+  Proxy proxy;
+
+private:
+  struct Shard {
+    detail::curl::Dispatcher dispatcher;
+    std::mutex mutex;
+    std::deque<detail::curl::Submission> queue;
+    std::atomic<bool> idle{true};
+    std::thread thread;
+  };
+
+  size_t shard_index(const Request& request) const {
+    const auto& authority = request.target().uri.authority;
+    const auto host = authority ? authority->host : std::string{};
+    return std::hash<std::string>{}(host) % shards_.size();
+  }
+
+  void run(const size_t index) {
+    auto& shard = *shards_[index];
+
+    while (!stopped_) {
+      auto queue = take(shard);
+      if (queue.empty() && !shard.dispatcher.active()) {
+        queue = steal(index);
+      }
+      for (auto& submission : queue) {
+        shard.dispatcher.add(std::move(submission));
+      }
+
+      int running_handles = 0;
+      shard.dispatcher.multi().perform(running_handles);
+      shard.dispatcher.complete();
+
+      shard.idle = !shard.dispatcher.active();
+      if (!stopped_ && !has_queued(shard)) {
+        shard.dispatcher.multi().poll(std::chrono::seconds{1});
+      }
+    }
+  }
+
+  std::deque<detail::curl::Submission> take(Shard& shard) {
+    std::deque<detail::curl::Submission> queue;
+    std::lock_guard lock{shard.mutex};
+    queue.swap(shard.queue);
+    return queue;
+  }
+
+  // Takes half of the queue of the most backlogged shard, starting from the
+  // back so that its owner keeps the requests it would have started next.
+  std::deque<detail::curl::Submission> steal(const size_t thief) {
+    std::deque<detail::curl::Submission> queue;
+
+    Shard* victim = nullptr;
+    size_t backlog = 0;
+    for (size_t i = 0; i < shards_.size(); ++i) {
+      if (i == thief) {
+        continue;
+      }
+      std::lock_guard lock{shards_[i]->mutex};
+      if (shards_[i]->queue.size() > backlog) {
+        backlog = shards_[i]->queue.size();
+        victim = shards_[i].get();
+      }
+    }
+
+    if (victim) {
+      std::lock_guard lock{victim->mutex};
+      auto count = (victim->queue.size() + 1) / 2;
+      while (count-- && !victim->queue.empty()) {
+        queue.push_front(std::move(victim->queue.back()));
+        victim->queue.pop_back();
+      }
+    }
+
+    return queue;
+  }
+
+  bool has_queued(Shard& shard) {
+    std::lock_guard lock{shard.mutex};
+    return !shard.queue.empty();
+  }
+
+  static void pin_thread(std::thread& thread, const size_t index) {
+#ifdef __linux__
+    const auto cpu_count = std::max(std::thread::hardware_concurrency(), 1u);
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    CPU_SET(index % cpu_count, &cpu_set);
+    pthread_setaffinity_np(thread.native_handle(), sizeof(cpu_set), &cpu_set);
+#else
+    static_cast<void>(thread);
+    static_cast<void>(index);
+#endif
+  }
+
+  detail::curl::Share cache_;
+  std::vector<std::unique_ptr<Shard>> shards_;
+  std::atomic<bool> stopped_{false};
+};
+
+}  // namespace hypr
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <utility>
+#include <vector>
+
+#include <hypr/detail/trace.hpp>
+
+// Records a few structured events for each transfer into a per-thread ring
+// buffer, for looking into slow or failed requests after the fact. Tracing is
+// cheap enough to be left on in production.
+namespace hypr::trace {
+
+using Event = detail::trace::Event;
+using EventType = detail::trace::EventType;
+
+inline void enable(const bool enabled = true) {
+  detail::trace::enabled = enabled;
+}
+
+inline bool enabled() {
+  return detail::trace::enabled;
+}
+
+// Returns the recent events of all threads, ordered by time.
+inline std::vector<Event> dump() {
+  return detail::trace::Registry::instance().dump();
+}
+
+// The handler is called with the recent events of the thread on which a
+// transfer has failed.
+inline void set_error_handler(detail::trace::error_handler_t handler) {
+  detail::trace::Registry::instance().set_error_handler(std::move(handler));
+}
+
+}  // namespace hypr::trace
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <functional>
+#include <utility>
+
+#include <hypr/detail/curl_interface.hpp>
+#include <hypr/detail/curl_session.hpp>
+#include <hypr/models.hpp>
+
+namespace hypr {
+
+// Sends requests on behalf of a session. Transports are not required to be
+// thread-safe unless stated otherwise.
+class Transport {
+public:
+  virtual ~Transport() = default;
+
+  virtual Response send(const Request& request,
+                        const Callbacks& callbacks,
+                        const Options& options,
+                        const Proxy& proxy,
+                        const Context& context) = 0;
+
+  // Same as `send`, but may reuse the buffers of an earlier response.
+  virtual void send_into(const Request& request,
+                         const Callbacks& callbacks,
+                         const Options& options,
+                         const Proxy& proxy,
+                         const Context& context,
+                         Response& response) {
+    response = send(request, callbacks, options, proxy, context);
+  }
+};
+
+// Sends requests over the network with libcurl. This is the default.
+class CurlTransport : public Transport {
+public:
+  Response send(const Request& request,
+                const Callbacks& callbacks,
+                const Options& options,
+                const Proxy& proxy,
+                const Context& context) override {
+    return detail::curl::Interface::send(request, callbacks, options, proxy,
+                                         context, session_);
+  }
+
+  void send_into(const Request& request,
+                 const Callbacks& callbacks,
+                 const Options& options,
+                 const Proxy& proxy,
+                 const Context& context,
+                 Response& response) override {
+    detail::curl::Interface::send_into(request, callbacks, options, proxy,
+                                       context, session_, response);
+  }
+
+private:
+  detail::curl::Session session_;
+};
+
+// Passes requests to a function in the same process, without touching the
+// network. Useful for testing and benchmarking the layers above a session.
+// Thread-safe as long as the handler is.
+class InMemoryTransport : public Transport {
+public:
+  using handler_t = std::function<Response(const Request&)>;
+
+  explicit InMemoryTransport(handler_t handler)
+      : handler_{std::move(handler)} {}
+
+  Response send(const Request& request,
+                const Callbacks& callbacks,
+                const Options&,
+                const Proxy&,
+                const Context& context) override {
+    if (context.cancelled()) {
+      return Response(CURLE_ABORTED_BY_CALLBACK);
+    }
+    if (context.expired()) {
+      return Response(CURLE_OPERATION_TIMEDOUT);
+    }
+
+    auto response = handler_(request);
+
+    // Behave like a transfer that received the whole body in a single chunk
+    auto& body = response.body();
+    const auto size = static_cast<int64_t>(body.size());
+    if (callbacks.transfer && size) {
+      if (!callbacks.transfer({size, size})) {
+        return Response(CURLE_ABORTED_BY_CALLBACK);
+      }
+    }
+    if (callbacks.write && !body.empty()) {
+      if (!callbacks.write(body)) {
+        return Response(CURLE_WRITE_ERROR);
+      }
+      body.clear();
+    }
+
+    return response;
+  }
+
+private:
+  handler_t handler_;
+};
+
+}  // namespace hypr
@@ -0,0 +1,220 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include <curl/curl.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#else
+#include <poll.h>
+#endif
+
+#include <hypr/detail/curl_interface.hpp>
+#include <hypr/detail/curl_session.hpp>
+#include <hypr/detail/models.hpp>
+#include <hypr/models.hpp>
+
+// https://curl.haxx.se/libcurl/c/libcurl-ws.html
+#if LIBCURL_VERSION_NUM >= 0x075600  // 7.86.0
+
+namespace hypr {
+
+// A WebSocket connection that is opened with the same options, proxy and TLS
+// settings as any other request. In non-blocking mode, `receive` returns
+// CURLE_AGAIN instead of waiting for data, and `socket` can be watched by an
+// event loop to know when to call it again.
+class WebSocket {
+public:
+  enum class MessageType {
+    Text,
+    Binary,
+    Close,
+    Ping,
+    Pong,
+  };
+
+  struct Message {
+    MessageType type = MessageType::Text;
+    std::string data;
+  };
+
+  // Performs the opening handshake. Blocks until the connection is upgraded.
+  Response connect(const Request& request) {
+    handshake_ = {};
+    message_ = {};
+    message_started_ = false;
+
+    if (const auto code = detail::curl::Interface::prepare(
+            request, callbacks, options, proxy, context, session_, handshake_);
+        code != CURLE_OK) {
+      return Response(code);
+    }
+
+    session_.setopt(CURLOPT_PROTOCOLS_STR, "ws,wss");
+    session_.setopt(CURLOPT_REDIR_PROTOCOLS_STR, "ws,wss");
+    session_.setopt(CURLOPT_CONNECT_ONLY, 2L);
+
+    const auto code = session_.perform();  // blocks
+
+    return detail::curl::Interface::complete(code, session_,
+                                             std::move(handshake_));
+  }
+
+  // Sends a whole message in a single frame. This blocks until the frame is
+  // sent, even in non-blocking mode, so that frames are never interleaved.
+  Error send(std::string_view data,
+             const MessageType type = MessageType::Text) {
+    const auto flags = to_flags(type);
+
+    while (true) {
+      size_t sent = 0;
+      const auto code = curl_ws_send(session_.get(), data.data(), data.size(),
+                                     &sent, 0, flags);
+      if (code == CURLE_AGAIN) {
+        if (const auto error = wait(POLLOUT)) {
+          return error;
+        }
+        continue;
+      }
+      if (code != CURLE_OK) {
+        return Error{code};
+      }
+      data.remove_prefix(sent);
+      if (data.empty()) {
+        return Error{};
+      }
+    }
+  }
+
+  // Receives a whole message, joining fragmented frames together.
+  Error receive(Message& message) {
+    char buffer[16 * 1024];
+
+    while (true) {
+      size_t received = 0;
+      const curl_ws_frame* frame = nullptr;
+      const auto code = recv(curl_ws_recv, buffer, sizeof(buffer), received,
+                             frame);
+      if (code == CURLE_AGAIN) {
+        if (non_blocking) {
+          return Error{code};
+        }
+        if (const auto error = wait(POLLIN)) {
+          return error;
+        }
+        continue;
+      }
+      if (code != CURLE_OK) {
+        return Error{code};
+      }
+
+      if (!message_started_) {
+        message_.type = to_type(frame->flags);
+        message_started_ = true;
+      }
+      message_.data.append(buffer, received);
+
+      if (!frame->bytesleft && !(frame->flags & CURLWS_CONT)) {
+        message = std::move(message_);
+        message_ = {};
+        message_started_ = false;
+        return Error{};
+      }
+    }
+  }
+
+  // Starts the closing handshake. The connection is closed by the server
+  // once it replies with a close message.
+  Error close(const uint16_t code = 1000, const std::string_view reason = {}) {
+    std::string payload;
+    payload.push_back(static_cast<char>(code >> 8));
+    payload.push_back(static_cast<char>(code & 0xFF));
+    payload.append(reason);
+    return send(payload, MessageType::Close);
+  }
+
+  curl_socket_t socket() const {
+    curl_socket_t socket = CURL_SOCKET_BAD;
+    session_.getinfo(CURLINFO_ACTIVESOCKET, socket);
+    return socket;
+  }
+
+  Callbacks callbacks;
+  Context context;
+  Options options;
+  Proxy proxy;
+
+  bool non_blocking = false;
+
+private:
+  // The frame pointer is const since libcurl 8.0.0, so we deduce its type
+  template <typename Frame>
+  CURLcode recv(CURLcode (*function)(CURL*, void*, size_t, size_t*, Frame**),
+                void* buffer, size_t size, size_t& received,
+                const curl_ws_frame*& frame) const {
+    Frame* meta = nullptr;
+    const auto code = function(session_.get(), buffer, size, &received, &meta);
+    frame = meta;
+    return code;
+  }
+
+  static unsigned int to_flags(const MessageType type) {
+    switch (type) {
+      case MessageType::Text: return CURLWS_TEXT;
+      case MessageType::Binary: return CURLWS_BINARY;
+      case MessageType::Close: return CURLWS_CLOSE;
+      case MessageType::Ping: return CURLWS_PING;
+      case MessageType::Pong: return CURLWS_PONG;
+    }
+    return CURLWS_BINARY;
+  }
+
+  static MessageType to_type(const int flags) {
+    if (flags & CURLWS_TEXT) return MessageType::Text;
+    if (flags & CURLWS_CLOSE) return MessageType::Close;
+    if (flags & CURLWS_PING) return MessageType::Ping;
+    if (flags & CURLWS_PONG) return MessageType::Pong;
+    return MessageType::Binary;
+  }
+
+  // Waits for the socket to become ready, checking the context regularly
+  Error wait(const short events) const {
+    constexpr int interval_ms = 100;
+
+    while (true) {
+      if (context.cancelled()) {
+        return Error{CURLE_ABORTED_BY_CALLBACK};
+      }
+      if (context.expired()) {
+        return Error{CURLE_OPERATION_TIMEDOUT};
+      }
+
+#ifdef _WIN32
+      WSAPOLLFD fd{socket(), events, 0};
+      const auto result = WSAPoll(&fd, 1, interval_ms);
+#else
+      pollfd fd{socket(), events, 0};
+      const auto result = ::poll(&fd, 1, interval_ms);
+#endif
+      if (result > 0) {
+        return Error{};
+      }
+      if (result < 0) {
+        return Error{CURLE_RECV_ERROR};
+      }
+    }
+  }
+
+  detail::curl::Session session_;
+  detail::Response handshake_;
+  Message message_;
+  bool message_started_ = false;
+};
+
+}  // namespace hypr
+
+#endif
@@ -1,5 +1,17 @@
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cstdio>
+#include <fstream>
 #include <iostream>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
 
 #include <hypr.hpp>
 
@@ -86,6 +98,9 @@ void test_request_query() {
   assert(r.target().uri.query.has_value());
   assert(r.target().uri.query.value() == "a=1&b=2");
 
+  r.set_query(hypr::Query{{"a b", "AZaz09-._~"}, {"c", "\xFF/\n"}});
+  assert(r.target().uri.query.value() == "a%20b=AZaz09-._~&c=%FF%2F%0A");
+
   r.set_query(hypr::Query{});
   assert(r.target().uri.query.has_value() == false);
 }
@@ -141,6 +156,48 @@ void test_request_body() {
     assert(r.body() == str);
     assert(r.header("content-type") == "application/json");
   }
+
+  {
+    hypr::Multipart multipart{{"a", "1"}};
+    multipart.add_file("b", "file.txt", "text/plain");
+    multipart.add_reader("c", [](char*, size_t) { return size_t{0}; }, 0);
+
+    hypr::Request r;
+    r.set_body(hypr::Body{str});
+    r.set_body(multipart);
+    assert(r.body().empty());
+    assert(r.header("content-type").empty());
+    assert(r.multipart().size() == 3);
+    assert(r.multipart()[0].data == "1");
+    assert(r.multipart()[1].path == "file.txt");
+    assert(r.multipart()[2].reader);
+
+    r.set_body(hypr::Body{str});
+    assert(r.multipart().empty());
+  }
+
+  {
+    // Parts are handed to libcurl as a form, which is dropped again once the
+    // request has a regular body
+    using hypr::detail::curl::Interface;
+    hypr::detail::curl::Session session;
+    hypr::detail::Response response;
+
+    hypr::Multipart multipart{{"a", "1"}};
+    multipart.add_reader("b", [](char*, size_t) { return size_t{0}; }, 0);
+
+    hypr::Request r;
+    r.set_target("http://localhost");
+    r.set_body(multipart);
+    assert(Interface::prepare(r, {}, {}, {}, {}, session, response) ==
+           CURLE_OK);
+    assert(session.mime.get());
+
+    r.set_body(hypr::Body{str});
+    assert(Interface::prepare(r, {}, {}, {}, {}, session, response) ==
+           CURLE_OK);
+    assert(!session.mime.get());
+  }
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -191,9 +248,994 @@ void test_session() {
   assert(is_response_ok(r2));
   assert(r2.url() == "https://httpbin.org/post?c=3&d=4");
 
+  auto r3 = r1;
+  session.send_into(request, r3);
+  assert(is_response_ok(r3));
+  assert(r3.url() == "https://httpbin.org/post?c=3&d=4");
+
   // @TODO: Test session options
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// Transport
+
+void test_transport() {
+  // Copies would share the easy handle of the default transport
+  static_assert(!std::is_copy_constructible_v<hypr::Session>);
+  static_assert(std::is_move_constructible_v<hypr::Session>);
+
+  auto transport = std::make_shared<hypr::InMemoryTransport>(
+      [](const hypr::Request& request) {
+        hypr::Response response;
+        response.set_status_code(hypp::status::k200_OK);
+        response.set_url(hypp::to_string(request.target()));
+        response.set_header("Content-Type", "text/plain");
+        response.set_body(request.method());
+        return response;
+      });
+
+  hypr::Session session;
+  session.set_transport(transport);
+
+  const auto r1 = session.request("POST", "http://localhost/echo");
+  assert(!r1.error());
+  assert(r1.status_code() == hypp::status::k200_OK);
+  assert(r1.url() == "http://localhost/echo");
+  assert(r1.header("Content-Type") == "text/plain");
+  assert(r1.body() == "POST");
+
+  std::string streamed;
+  session.callbacks.write = [&streamed](std::string_view data) {
+    streamed.append(data);
+    return true;
+  };
+  const auto r2 = session.request("GET", "http://localhost");
+  assert(!r2.error());
+  assert(r2.body().empty());
+  assert(streamed == "GET");
+
+  session.callbacks.write = [](std::string_view) { return false; };
+  const auto r3 = session.request("GET", "http://localhost");
+  assert(r3.error().code == CURLE_WRITE_ERROR);
+
+  session.callbacks.write = nullptr;
+  hypr::Request request;
+  request.set_target("http://localhost/into");
+  auto r4 = r1;
+  session.send_into(request, r4);
+  assert(!r4.error());
+  assert(r4.url() == "http://localhost/into");
+  assert(r4.body() == "GET");
+
+  // Responses are cleared before they are reused, even if the request fails,
+  // but their buffers are kept
+  r4.set_body(std::string(1000, 'x'));
+  const auto capacity = r4.body().capacity();
+  session.set_transport(nullptr);
+  request.set_target("ftp://localhost");
+  session.send_into(request, r4);
+  assert(r4.error().code == CURLE_UNSUPPORTED_PROTOCOL);
+  assert(r4.status_code() == 0);
+  assert(r4.url().empty());
+  assert(r4.headers().empty());
+  assert(r4.body().empty());
+  assert(r4.body().capacity() == capacity);
+
+  session.set_transport(transport);
+  session.context.cancellation.cancel();
+  const auto r5 = session.request("GET", "http://localhost");
+  assert(r5.error().code == CURLE_ABORTED_BY_CALLBACK);
+
+  // Moved-from sessions fall back to the default transport
+  session.context = {};
+  auto moved = std::move(session);
+  assert(moved.request("GET", "http://localhost").body() == "GET");
+  const auto r6 = session.request("GET", "ftp://localhost");
+  assert(r6.error().code == CURLE_UNSUPPORTED_PROTOCOL);
+}
+
+void test_unix_socket() {
+  hypr::Session session;
+
+  // The host is not even looked up
+  session.options.unix_socket = "hypr_test_missing.sock";
+  const auto r1 = session.request("GET", "http://hypr.invalid/");
+  assert(r1.error().code == CURLE_COULDNT_CONNECT);
+
+  session.options.unix_socket.clear();
+  const auto r2 = session.request("GET", "http://hypr.invalid/");
+  assert(r2.error().code == CURLE_COULDNT_RESOLVE_HOST);
+
+#ifdef HYPR_UNIX_SOCKET_SERVER
+  session.options.unix_socket = HYPR_UNIX_SOCKET_SERVER;
+  const auto r3 = session.request("GET", "http://localhost/");
+  assert(!r3.error());
+  assert(r3.status_code() != 0);
+#endif
+}
+
+void test_coalescing() {
+  constexpr int expected = 8;
+  std::atomic<int> calls = 0;
+  std::atomic<bool> release = false;
+
+  const auto transport = std::make_shared<hypr::InMemoryTransport>(
+      [&](const hypr::Request&) {
+        ++calls;
+        while (!release) {
+          std::this_thread::yield();
+        }
+        hypr::Response response;
+        response.set_status_code(hypp::status::k200_OK);
+        response.set_body("shared");
+        return response;
+      });
+  const auto coalescer = std::make_shared<hypr::Coalescer>();
+
+  std::vector<std::thread> threads;
+  std::atomic<int> completed = 0;
+  for (int i = 0; i < expected; ++i) {
+    threads.emplace_back([&]() {
+      hypr::Session session;
+      session.set_transport(
+          std::make_shared<hypr::CoalescingTransport>(coalescer, transport));
+      const auto r = session.request("GET", "http://localhost");
+      assert(r.body() == "shared");
+      ++completed;
+    });
+  }
+
+  // The leader is only released once everyone else has joined its request
+  while (calls == 0 || coalescer->waiting() < expected - 1) {
+    std::this_thread::yield();
+  }
+  release = true;
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  assert(completed == expected);
+  assert(calls == 1);
+  assert(coalescer->size() == 0);
+  assert(coalescer->waiting() == 0);
+
+  // Requests with a body are never coalesced
+  hypr::Session session;
+  session.set_transport(
+      std::make_shared<hypr::CoalescingTransport>(coalescer, transport));
+  session.request("GET", "http://localhost", hypr::Body{"body"});
+  assert(calls == 2);
+}
+
+void test_recording() {
+  const std::string path = "hypr_test_recording.bin";
+
+  {
+    auto recorder = std::make_shared<hypr::Recorder>(path);
+    assert(recorder->is_open());
+
+    hypr::Session session;
+    session.set_transport(std::make_shared<hypr::RecordingTransport>(
+        recorder, std::make_shared<hypr::InMemoryTransport>(
+                      [](const hypr::Request& request) {
+                        hypr::Response response;
+                        response.set_status_code(hypp::status::k200_OK);
+                        response.set_header("X-Method", request.method());
+                        response.set_body(hypp::to_string(request.target()));
+                        return response;
+                      })));
+    session.request("GET", "http://localhost/a");
+    hypr::Request request;
+    request.set_method("POST");
+    request.set_target("http://localhost/b");
+    request.set_body(hypr::Body{"body"});
+    request.set_headers({{"Authorization", "Bearer secret"}});
+    session.send(request);
+  }
+
+  std::vector<hypr::Exchange> exchanges;
+  assert(hypr::read_recording(path, exchanges));
+  std::remove(path.c_str());
+
+  assert(exchanges.size() == 2);
+  assert(exchanges[0].offset <= exchanges[1].offset);
+  assert(exchanges[1].request.method() == "POST");
+  assert(exchanges[1].request.body() == "body");
+  // Only the headers that were sent are restored
+  assert(exchanges[1].request.headers().size() == 1);
+  assert(exchanges[1].request.header("Content-Type").empty());
+  assert(exchanges[1].request.header("Authorization") == "REDACTED");
+  assert(exchanges[1].response.status_code() == hypp::status::k200_OK);
+  assert(exchanges[1].response.header("X-Method") == "POST");
+  assert(exchanges[1].response.body() == "http://localhost/b");
+
+  hypr::Session session;
+  session.set_transport(std::make_shared<hypr::ReplayTransport>(exchanges));
+  assert(session.request("GET", "http://localhost/a").body() ==
+         "http://localhost/a");
+  assert(session.request("GET", "http://localhost/b").status_code() ==
+         hypp::status::k404_Not_Found);
+
+  // Requests are sent again on their original schedule
+  for (auto& exchange : exchanges) {
+    exchange.request.set_target("ftp://localhost");
+  }
+  hypr::Replayer replayer;
+  int completed = 0;
+  replayer.replay(exchanges, [&completed](const hypr::Exchange&,
+                                          hypr::Response&& response) {
+    assert(response.error().code == CURLE_UNSUPPORTED_PROTOCOL);
+    ++completed;
+  });
+  assert(completed == 2);
+}
+
+void test_endpoints() {
+  bool rejected = false;
+  try {
+    hypr::EndpointSet{std::vector<std::string>{}};
+  } catch (const std::invalid_argument&) {
+    rejected = true;
+  }
+  assert(rejected);
+
+  const auto endpoints = std::make_shared<hypr::EndpointSet>(
+      std::vector<std::string>{"http://a:8080", "http://b:8080"});
+  endpoints->max_failures = 2;
+  endpoints->ejection_time = std::chrono::milliseconds{50};
+
+  std::atomic<bool> b_is_down = true;
+  hypr::Session session;
+  session.set_transport(std::make_shared<hypr::BalancingTransport>(
+      endpoints, std::make_shared<hypr::InMemoryTransport>(
+                     [&b_is_down](const hypr::Request& request) {
+                       const auto url = hypp::to_string(request.target());
+                       hypr::Response response;
+                       response.set_status_code(
+                           b_is_down && url.find("http://b:8080") == 0
+                               ? hypp::status::k503_Service_Unavailable
+                               : hypp::status::k200_OK);
+                       response.set_body(url);
+                       return response;
+                     })));
+
+  // Requests go to both endpoints until the failing one is ejected
+  int failures = 0;
+  for (int i = 0; i < 20; ++i) {
+    const auto r = session.request("GET", "http://localhost/path?q");
+    assert(r.body() == "http://a:8080/path?q" ||
+           r.body() == "http://b:8080/path?q");
+    if (r.status_code() != hypp::status::k200_OK) {
+      ++failures;
+    }
+  }
+  assert(failures == 2);
+  assert(!endpoints->status()[0].ejected);
+  assert(endpoints->status()[1].ejected);
+
+  // A probe reinstates the endpoint once it recovers
+  b_is_down = false;
+  std::this_thread::sleep_for(std::chrono::milliseconds{60});
+  bool probed = false;
+  for (int i = 0; i < 20 && !probed; ++i) {
+    probed = session.request("GET", "http://localhost/path").body() ==
+             "http://b:8080/path";
+  }
+  assert(probed);
+  assert(!endpoints->status()[1].ejected);
+  assert(endpoints->status()[1].outstanding == 0);
+}
+
+void test_limiter() {
+  const auto limiter = std::make_shared<hypr::ConcurrencyLimiter>();
+  limiter->initial_limit = 1;
+  limiter->max_queued = 1;
+  limiter->max_queue_time = std::chrono::milliseconds{50};
+
+  std::atomic<bool> release = false;
+  std::atomic<hypr::StatusCode> status = hypp::status::k200_OK;
+  const auto transport = std::make_shared<hypr::LimitingTransport>(
+      limiter, std::make_shared<hypr::InMemoryTransport>(
+                   [&](const hypr::Request&) {
+                     while (!release) {
+                       std::this_thread::yield();
+                     }
+                     hypr::Response response;
+                     response.set_status_code(status);
+                     response.set_elapsed(std::chrono::milliseconds{10});
+                     return response;
+                   }));
+
+  std::thread first([&transport]() {
+    hypr::Session session;
+    session.set_transport(transport);
+    assert(!session.request("GET", "http://localhost").error());
+  });
+  while (limiter->status().empty() || !limiter->status()[0].in_flight) {
+    std::this_thread::yield();
+  }
+
+  hypr::Session session;
+  session.set_transport(transport);
+
+  // Requests over the limit wait in line, and are shed if they wait too long
+  const auto r1 = session.request("GET", "http://localhost");
+  assert(r1.error().code == CURLE_OPERATION_TIMEDOUT);
+
+  release = true;
+  first.join();
+  assert(!session.request("GET", "http://localhost").error());
+
+  // Errors lower the limit by a fixed ratio
+  limiter->initial_limit = 10;
+  status = hypp::status::k503_Service_Unavailable;
+  for (int i = 0; i < 5; ++i) {
+    session.request("GET", "http://127.0.0.1");
+  }
+  for (const auto& host : limiter->status()) {
+    assert(host.in_flight == 0);
+    if (host.host == "127.0.0.1") {
+      assert(host.limit == 5);  // 10 * 0.9^5
+    } else {
+      assert(host.limit == 1);
+      assert(host.latency == std::chrono::milliseconds{10});
+    }
+  }
+
+  // The limit grows while latency stays within the tolerance over the
+  // baseline, as long as it is used up, and shrinks once latency rises above
+  hypr::ConcurrencyLimiter adaptive;
+  adaptive.initial_limit = 10;
+  const auto limit = [&adaptive]() { return adaptive.status().front().limit; };
+  const auto run = [&](const std::chrono::milliseconds elapsed,
+                       const int rounds) {
+    hypr::Response response;
+    response.set_status_code(hypp::status::k200_OK);
+    response.set_elapsed(elapsed);
+    for (int round = 0; round < rounds; ++round) {
+      const auto count = adaptive.status().empty() ? 1 : limit();
+      for (size_t i = 0; i < count; ++i) {
+        assert(adaptive.acquire("localhost", {}) == CURLE_OK);
+      }
+      for (size_t i = 0; i < count; ++i) {
+        adaptive.release("localhost", response);
+      }
+    }
+  };
+  run(std::chrono::milliseconds{10}, 1);
+  assert(limit() == 10);
+  assert(adaptive.status().front().baseline == std::chrono::milliseconds{10});
+  run(std::chrono::milliseconds{14}, 5);
+  const auto grown = limit();
+  assert(grown > 10);
+  run(std::chrono::milliseconds{100}, 5);
+  assert(limit() < grown);
+
+  // Hosts are forgotten once there are too many, unless they are busy
+  hypr::Response response;
+  assert(adaptive.acquire("localhost", {}) == CURLE_OK);
+  for (size_t i = 0; i < hypr::ConcurrencyLimiter::kMaxHosts; ++i) {
+    const auto host = std::to_string(i);
+    assert(adaptive.acquire(host, {}) == CURLE_OK);
+    adaptive.release(host, response);
+  }
+  const auto hosts = adaptive.status();
+  assert(hosts.size() == hypr::ConcurrencyLimiter::kMaxHosts);
+  assert(std::any_of(hosts.begin(), hosts.end(), [](const auto& host) {
+    return host.host == "localhost" && host.in_flight == 1;
+  }));
+  adaptive.release("localhost", response);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Client
+
+#ifdef HYPR_HAS_COROUTINES
+struct DetachedTask {
+  struct promise_type {
+    DetachedTask get_return_object() { return {}; }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() { std::terminate(); }
+  };
+};
+
+DetachedTask send_unsupported(hypr::Client& client, int& completed) {
+  hypr::Request request;
+  request.set_target("ftp://localhost");
+  const auto r = co_await client.send(request);
+  assert(r.error().code == CURLE_UNSUPPORTED_PROTOCOL);
+  ++completed;
+}
+#endif
+
+void test_client() {
+  using namespace std::chrono_literals;
+
+  hypr::Client client;
+  int completed = 0;
+
+  hypr::Request request;
+  request.set_target("ftp://localhost");
+  client.send_async(request, [&completed](hypr::Response&& r) {
+    assert(r.error().code == CURLE_UNSUPPORTED_PROTOCOL);
+    ++completed;
+  });
+
+#ifdef HYPR_HAS_COROUTINES
+  send_unsupported(client, completed);
+  constexpr int expected = 2;
+#else
+  constexpr int expected = 1;
+#endif
+
+  while (completed < expected) {
+    client.poll(100ms);
+  }
+
+  // Requests of higher priority skip ahead of those waiting for a slot
+  client.max_transfers = 1;
+  std::vector<hypr::Priority> order;
+  for (const auto priority : {hypr::Priority::Low, hypr::Priority::Normal,
+                              hypr::Priority::High}) {
+    request.set_priority(priority);
+    client.send_async(request, [&order, priority](hypr::Response&&) {
+      order.push_back(priority);
+    });
+  }
+  while (order.size() < 3) {
+    client.poll(100ms);
+  }
+  assert((order == std::vector<hypr::Priority>{hypr::Priority::High,
+                                               hypr::Priority::Normal,
+                                               hypr::Priority::Low}));
+
+  // Recycled responses lend their buffers to later transfers, but none of
+  // their state
+  hypr::Response spare{CURLE_WRITE_ERROR};
+  spare.set_status_code(hypp::status::k200_OK);
+  spare.set_url("http://localhost/stale");
+  spare.set_header("X-Stale", "1");
+  spare.set_body(std::string(1000, 'x'));
+  client.recycle(std::move(spare));
+  bool recycled = false;
+  client.send_async(request, [&recycled](hypr::Response&& r) {
+    assert(r.error().code == CURLE_UNSUPPORTED_PROTOCOL);
+    assert(r.status_code() == 0);
+    assert(r.url().empty());
+    assert(r.headers().empty());
+    assert(r.body().empty());
+    assert(r.body().capacity() >= 1000);
+    assert(r.digest().empty());
+    recycled = true;
+  });
+  while (!recycled) {
+    client.poll(100ms);
+  }
+}
+
+void test_driver() {
+  std::optional<std::chrono::milliseconds> timer;
+  hypr::Driver driver{
+      [](curl_socket_t, int) {},
+      [&timer](std::optional<std::chrono::milliseconds> timeout) {
+        timer = timeout;
+      }};
+
+  bool completed = false;
+
+  hypr::Request request;
+  request.set_target("ftp://localhost");
+  driver.send_async(request, [&completed](hypr::Response&& r) {
+    assert(r.error().code == CURLE_UNSUPPORTED_PROTOCOL);
+    completed = true;
+  });
+
+  while (!completed) {
+    assert(timer.has_value());
+    timer.reset();
+    driver.on_timeout();
+  }
+  assert(driver.active() == 0);
+}
+
+void test_sharded_client() {
+  constexpr int expected = 16;
+  std::atomic<int> completed = 0;
+
+  {
+    hypr::ShardedClient client{4};
+    assert(client.shard_count() == 4);
+
+    hypr::Request request;
+    request.set_target("ftp://localhost");
+    for (int i = 0; i < expected; ++i) {
+      client.send_async(request, [&completed](hypr::Response&& r) {
+        assert(r.error().code == CURLE_UNSUPPORTED_PROTOCOL);
+        ++completed;
+      });
+    }
+
+    while (completed < expected) {
+      std::this_thread::yield();
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Download
+
+void test_download_segments() {
+  hypr::Response response;
+  response.set_status_code(hypp::status::k200_OK);
+  response.set_header("Accept-Ranges", "bytes");
+  response.set_header("Content-Length", "10000000");
+  assert(hypr::detail::get_ranged_size(response) == 10000000);
+
+  response.set_header("Content-Length", "100abc");
+  assert(!hypr::detail::get_ranged_size(response));
+  response.set_header("Content-Length", "0");
+  assert(!hypr::detail::get_ranged_size(response));
+  response.set_header("Content-Length", "100");
+  response.set_header("Accept-Ranges", "none");
+  assert(!hypr::detail::get_ranged_size(response));
+  response.set_header("Accept-Ranges", "bytes");
+  response.set_status_code(hypp::status::k404_Not_Found);
+  assert(!hypr::detail::get_ranged_size(response));
+
+  // Files of unknown size are not split
+  const auto unranged = hypr::detail::split_segments(std::nullopt, 4, 1024);
+  assert(unranged.size() == 1);
+  assert(!unranged[0].ranged);
+
+  // Segments are contiguous, and no smaller than the minimum
+  const auto segments = hypr::detail::split_segments(10001, 4, 1000);
+  assert(segments.size() == 4);
+  assert(segments.front().begin == 0);
+  assert(segments.back().end == 10001);
+  for (size_t i = 1; i < segments.size(); ++i) {
+    assert(segments[i].ranged);
+    assert(segments[i].begin == segments[i - 1].end);
+  }
+  assert(hypr::detail::split_segments(2500, 4, 1000).size() == 2);
+  assert(hypr::detail::split_segments(500, 4, 1000).size() == 1);
+}
+
+void test_file() {
+  const std::string path = "hypr_test_file.bin";
+  {
+    hypr::detail::File file;
+    assert(file.open(path));
+    assert(file.allocate(8));
+    assert(file.write_at(4, "5678"));
+    assert(file.write_at(0, "1234"));
+  }
+  const auto read = [&path]() {
+    std::ifstream stream{path, std::ios::binary};
+    return std::string{std::istreambuf_iterator<char>{stream}, {}};
+  };
+  assert(read() == "12345678");
+
+  // Files are kept as they are until they are resized
+  {
+    hypr::detail::File file;
+    assert(file.open(path));
+    assert(read() == "12345678");
+    assert(file.truncate());
+    assert(file.write_at(0, "ab"));
+  }
+  assert(read() == "ab");
+
+  // Segments that fail to start are retried, and then reported
+  hypr::Downloader downloader;
+  downloader.context = hypr::Context{std::chrono::steady_clock::now()};
+  hypr::Request request;
+  request.set_target("http://localhost/file");
+  assert(downloader.download(request, path).code == CURLE_OPERATION_TIMEDOUT);
+  assert(read() == "ab");
+
+  // Segmented downloads are verified as a whole
+  {
+    hypr::detail::File file;
+    assert(file.open(path));
+    assert(file.write_at(0, "123456789"));
+  }
+  assert(hypr::detail::digest_file(path, hypr::DigestAlgorithm::Crc32c) ==
+         "e3069283");
+  std::remove(path.c_str());
+  assert(!hypr::detail::digest_file(path, hypr::DigestAlgorithm::Crc32c));
+
+#ifdef HYPR_DOWNLOAD_SERVER
+  // A file that is served with range requests, e.g. "http://localhost/file"
+  request.set_target(HYPR_DOWNLOAD_SERVER);
+  hypr::Session session;
+  session.options.digest = hypr::DigestAlgorithm::Sha256;
+  const auto whole = session.send(request);
+  assert(!whole.error());
+
+  // Responses without a body are not verified
+  session.options.expected_digest = whole.digest();
+  assert(!session.request("HEAD", HYPR_DOWNLOAD_SERVER).error());
+
+  // The digest is not expected of the probe or the segments
+  hypr::Downloader segmented;
+  segmented.max_segments = 4;
+  segmented.min_segment_size = 1;
+  segmented.options.digest = hypr::DigestAlgorithm::Sha256;
+  segmented.options.expected_digest = whole.digest();
+  segmented.options.verbose = true;
+  int ranged_requests = 0;
+  segmented.callbacks.debug = [&ranged_requests](curl_infotype type,
+                                                 std::string_view data) {
+    if (type == CURLINFO_HEADER_OUT &&
+        data.find("Range: bytes=") != data.npos) {
+      ++ranged_requests;
+    }
+  };
+  assert(!segmented.download(request, path));
+  assert(ranged_requests == 4);
+  assert(read() == whole.body());
+
+  segmented.options.expected_digest = std::string(64, '0');
+  assert(segmented.download(request, path).code ==
+         CURLE_BAD_CONTENT_ENCODING);
+  std::remove(path.c_str());
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Server-sent events
+
+void test_event_stream_parser() {
+  std::vector<hypr::ServerSentEvent> events;
+  const auto handler = [&events](const hypr::ServerSentEvent& event) {
+    events.push_back(event);
+  };
+
+  hypr::detail::EventStreamParser parser;
+
+  parser.parse(": comment\r\ndata: first\r", handler);
+  assert(events.empty());
+  parser.parse("\ndata:second line\n\n", handler);
+  assert(events.size() == 1);
+  assert(events[0].type == "message");
+  assert(events[0].data == "first\nsecond line");
+  assert(events[0].id.empty());
+
+  parser.parse("event: update\nid: 42\nretry: 500\nda", handler);
+  parser.parse("ta: {}\n\n", handler);
+  assert(events.size() == 2);
+  assert(events[1].type == "update");
+  assert(events[1].data == "{}");
+  assert(events[1].id == "42");
+  assert(parser.last_event_id() == "42");
+  assert(parser.retry() == std::chrono::milliseconds{500});
+
+  parser.parse("event: empty\n\nretry: x\ndata\n\n", handler);
+  assert(events.size() == 3);
+  assert(events[2].type == "message");
+  assert(events[2].data.empty());
+  assert(events[2].id == "42");
+  assert(parser.retry() == std::chrono::milliseconds{500});
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Pagination
+
+void test_link_header() {
+  using hypr::detail::find_link;
+  using hypr::detail::resolve_url;
+
+  const std::string header =
+      R"(<https://api.example.com/items?page=1&x=a,b>; rel="prev first", )"
+      R"(</items?page=3>; title="a, b; c"; REL=next, <?page=9>; rel=last)";
+  const std::string first = "https://api.example.com/items?page=1&x=a,b";
+  assert(find_link(header, "prev") == first);
+  assert(find_link(header, "first") == first);
+  assert(find_link(header, "next") == "/items?page=3");
+  assert(find_link(header, "last") == "?page=9");
+  assert(!find_link(header, "self"));
+  assert(!find_link("", "next"));
+  assert(!find_link("<broken; rel=next", "next"));
+
+  const std::string base = "https://example.com/api/items?page=2";
+  assert(resolve_url(base, "http://other.com/a") == "http://other.com/a");
+  assert(resolve_url(base, "//other.com/a") == "https://other.com/a");
+  assert(resolve_url(base, "/b?page=3") == "https://example.com/b?page=3");
+  assert(resolve_url(base, "?page=3") ==
+         "https://example.com/api/items?page=3");
+  assert(resolve_url(base, "more?page=3") ==
+         "https://example.com/api/more?page=3");
+  assert(resolve_url("https://example.com", "a") == "https://example.com/a");
+}
+
+void test_pagination() {
+  constexpr int page_count = 5;
+  std::atomic<int> fetched = 0;
+
+  hypr::Paginator pages;
+  pages.prefetch = 2;
+  pages.transport = std::make_shared<hypr::InMemoryTransport>(
+      [&fetched](const hypr::Request& request) {
+        ++fetched;
+        const auto target = hypp::to_string(request.target());
+        const auto page = std::stoi(target.substr(target.rfind('=') + 1));
+        hypr::Response response;
+        response.set_status_code(hypp::status::k200_OK);
+        response.set_url(target);
+        response.set_body(std::to_string(page));
+        if (page < page_count) {
+          response.set_header(
+              "Link", "</items?page=" + std::to_string(page + 1) +
+                          ">; rel=\"next\"");
+        }
+        return response;
+      });
+
+  // Nothing to wait for before the walk has started
+  assert(!pages.next());
+
+  hypr::Request request;
+  request.set_target("http://localhost/items?page=1");
+  pages.start(request);
+
+  int count = 0;
+  while (const auto page = pages.next()) {
+    ++count;
+    assert(page->body() == std::to_string(count));
+    // Pages are fetched ahead, but not too far
+    assert(fetched <= count + 2);
+    if (count == 1) {
+      while (fetched < 3) {
+        std::this_thread::yield();
+      }
+    }
+  }
+  assert(count == page_count);
+  assert(fetched == page_count);
+
+  // Pages can be found without Link headers as well
+  pages.next_page = [](const hypr::Request& request, const hypr::Response&)
+      -> std::optional<hypr::Request> {
+    return request;
+  };
+  pages.start(request);
+  assert(pages.next());
+  assert(pages.next());
+  pages.stop();
+  // Pages that were fetched ahead are dropped
+  assert(!pages.next());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// WebSocket
+
+#ifdef HYPR_WEBSOCKET_ECHO_SERVER
+void test_websocket() {
+  hypr::Request request;
+  request.set_target(HYPR_WEBSOCKET_ECHO_SERVER);
+
+  hypr::WebSocket ws;
+  const auto r = ws.connect(request);
+  assert(!r.error());
+  assert(r.status_code() == 101);
+
+  hypr::WebSocket::Message message;
+
+  assert(!ws.send("My body is ready."));
+  assert(!ws.receive(message));
+  assert(message.type == hypr::WebSocket::MessageType::Text);
+  assert(message.data == "My body is ready.");
+
+  const std::string binary(100000, '\0');
+  assert(!ws.send(binary, hypr::WebSocket::MessageType::Binary));
+  assert(!ws.receive(message));
+  assert(message.type == hypr::WebSocket::MessageType::Binary);
+  assert(message.data == binary);
+
+  ws.non_blocking = true;
+  assert(ws.receive(message).code == CURLE_AGAIN);
+  ws.non_blocking = false;
+
+  assert(!ws.close());
+  assert(!ws.receive(message));
+  assert(message.type == hypr::WebSocket::MessageType::Close);
+}
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+// Context
+
+void test_context() {
+  using namespace std::chrono_literals;
+
+  {
+    hypr::Context parent;
+    assert(!parent.remaining().has_value());
+
+    const auto child = parent.child(100ms);
+    assert(child.remaining().has_value());
+    assert(child.remaining().value() <= 100ms);
+
+    parent.cancellation.cancel();
+    assert(parent.cancelled());
+    assert(child.cancelled());
+  }
+
+  {
+    const hypr::Context parent{50ms};
+    const auto child = parent.child(1h);
+    assert(child.remaining().value() <= 50ms);
+
+    child.cancellation.cancel();
+    assert(child.cancelled());
+    assert(!parent.cancelled());
+  }
+
+  {
+    hypr::Context context;
+    context.cancellation.cancel();
+    const auto r = hypr::get("http://localhost", context);
+    assert(r.error().code == CURLE_ABORTED_BY_CALLBACK);
+  }
+
+  {
+    const hypr::Context context{0ms};
+    const auto r = hypr::get("http://localhost", context);
+    assert(r.error().code == CURLE_OPERATION_TIMEDOUT);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Digest
+
+void test_digest() {
+  const auto digest = [](hypr::DigestAlgorithm algorithm,
+                         std::initializer_list<std::string_view> chunks) {
+    hypr::detail::Digester digester{algorithm};
+    for (const auto chunk : chunks) {
+      digester.update(chunk);
+    }
+    return hypr::detail::to_hex(digester.bytes());
+  };
+
+  constexpr auto crc32c = hypr::DigestAlgorithm::Crc32c;
+  assert(digest(crc32c, {}) == "00000000");
+  assert(digest(crc32c, {"123456789"}) == "e3069283");
+  assert(digest(crc32c, {"1234", "56789"}) == "e3069283");
+
+  constexpr auto sha256 = hypr::DigestAlgorithm::Sha256;
+  assert(digest(sha256, {""}) ==
+         "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+  assert(digest(sha256, {"a", "bc"}) ==
+         "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+  const std::string million(1000000, 'a');
+  assert(digest(sha256, {std::string_view{million}.substr(0, 100),
+                         std::string_view{million}.substr(100)}) ==
+         "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+
+  const auto found = hypr::detail::find_digest(
+      "crc32c=4waSgw==, sha-256=:ungWv48Bz+pBQUDeXa4iI7ADYaOWF3qctBD/YfIAFa0=:",
+      "SHA-256");
+  assert(found.has_value());
+  assert(hypr::detail::to_hex(*found) ==
+         "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+  assert(!hypr::detail::find_digest("md5=abc", "crc32c").has_value());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Memory
+
+void test_memory_budget() {
+  hypr::memory::set_budget(100);
+
+  {
+    hypr::detail::MemoryCharge a;
+    hypr::detail::MemoryCharge b;
+    assert(a.add(60));
+    assert(b.add(40));
+    assert(hypr::memory::stats().used == 100);
+
+    // A single charge can go over the budget until it is finished
+    assert(a.add(10));
+    assert(!b.add(10));
+    b.pause();
+    assert(hypr::memory::stats().paused == 1);
+    assert(!hypr::detail::MemoryBudget::instance().has_room());
+
+    a.finish();
+    assert(hypr::detail::MemoryBudget::instance().has_room());
+    assert(b.add(10));
+    b.finish();
+    assert(hypr::memory::stats().paused == 0);
+
+    const auto c = std::move(a);
+    assert(hypr::memory::stats().used == 120);
+  }
+
+  const auto stats = hypr::memory::stats();
+  assert(stats.used == 0);
+  assert(stats.peak >= 120);
+  assert(stats.pauses >= 1);
+
+  hypr::memory::set_budget(0);
+}
+
+void test_buffer_sizes() {
+  using hypr::detail::BufferSizes;
+
+  constexpr long min = 16 * 1024;
+  constexpr long max = 2 * 1024 * 1024;
+  assert(BufferSizes::to_size(0, min, max) == min);
+  assert(BufferSizes::to_size(16e6, min, max) == min);
+  assert(BufferSizes::to_size(100e6, min, max) == 128 * 1024);
+  assert(BufferSizes::to_size(10e9, min, max) == max);
+
+  assert(BufferSizes::average(0, 1000) == 1000);
+  assert(BufferSizes::average(1000, 2000) == 1300);
+
+  constexpr auto large = BufferSizes::kMinSample;
+  BufferSizes sizes;
+
+  // Small transfers say little about bandwidth
+  sizes.update("a", {1024, 1'000'000'000}, {});
+  assert(sizes.size() == 0);
+  assert(sizes.get("a").download == BufferSizes::kMinDownload);
+
+  sizes.update("a", {large, 1'000'000'000}, {});
+  assert(sizes.get("a").download == 1024 * 1024);
+  assert(sizes.get("a").upload == BufferSizes::kMinUpload);
+
+  // The least recently updated hosts are forgotten first
+  for (size_t i = 0; i < BufferSizes::kMaxHosts; ++i) {
+    sizes.update(std::to_string(i), {large, 1'000'000'000}, {});
+    if (i == 0) {
+      sizes.update("a", {large, 1'000'000'000}, {});
+    }
+  }
+  assert(sizes.size() == BufferSizes::kMaxHosts);
+  assert(sizes.get("a").download == 1024 * 1024);
+  assert(sizes.get("0").download == BufferSizes::kMinDownload);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Trace
+
+void test_trace() {
+  std::vector<hypr::trace::Event> errors;
+  hypr::trace::set_error_handler(
+      [&errors](const std::vector<hypr::trace::Event>& events) {
+        errors = events;
+      });
+  hypr::trace::enable();
+
+  const auto r = hypr::get("ftp://localhost");
+  assert(r.error().code == CURLE_UNSUPPORTED_PROTOCOL);
+
+  // Rings of threads that have exited are reused
+  std::vector<uint32_t> threads;
+  for (int i = 0; i < 2; ++i) {
+    std::thread{[]() { hypr::get("ftp://localhost"); }}.join();
+    threads.push_back(errors.back().thread);
+  }
+  assert(threads[0] == threads[1]);
+
+  hypr::trace::enable(false);
+  hypr::trace::set_error_handler(nullptr);
+
+  assert(!errors.empty());
+  assert(errors.back().type == hypr::trace::EventType::Error);
+  assert(errors.back().value == CURLE_UNSUPPORTED_PROTOCOL);
+
+  const auto events = hypr::trace::dump();
+  assert(!events.empty());
+  assert(std::is_sorted(events.begin(), events.end(),
+                        [](const auto& a, const auto& b) {
+                          return a.time < b.time;
+                        }));
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // Error handling
 
@@ -216,6 +1258,28 @@ void test_all() {
   test_response_advanced();
   test_session();
 #endif
+  test_transport();
+  test_unix_socket();
+  test_coalescing();
+  test_recording();
+  test_endpoints();
+  test_limiter();
+  test_client();
+  test_driver();
+  test_sharded_client();
+  test_download_segments();
+  test_file();
+  test_event_stream_parser();
+  test_link_header();
+  test_pagination();
+#ifdef HYPR_WEBSOCKET_ECHO_SERVER
+  test_websocket();
+#endif
+  test_context();
+  test_digest();
+  test_memory_budget();
+  test_buffer_sizes();
+  test_trace();
   test_error_handling();
 
   std::cout << "hypr passed all tests!\n";
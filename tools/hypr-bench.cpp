@@ -0,0 +1,252 @@
+// Open-loop load generator built on hypr.
+//
+// Requests are started at a fixed arrival rate, regardless of how long earlier
+// requests take. Latency is measured from the time a request was scheduled to
+// start rather than from when it was actually sent, so queueing delay caused
+// by a slow server is not hidden (no coordinated omission).
+//
+// Usage: hypr-bench [options] <url>...
+//   --rate N          requests per second (default: 100)
+//   --duration S      seconds to run for (default: 10)
+//   --concurrency N   maximum requests in flight (default: 64)
+//   --method M        request method (default: GET)
+//   --header H        request header, e.g. "Accept: text/plain" (repeatable)
+//   --body B          request body
+//   --timeout MS      total timeout per request (default: none)
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <hypr.hpp>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Config {
+  double rate = 100;
+  std::chrono::seconds duration{10};
+  size_t concurrency = 64;
+  std::chrono::milliseconds timeout{0};
+  std::vector<hypr::Request> requests;
+};
+
+struct Results {
+  std::vector<int64_t> latencies;  // microseconds
+  std::map<CURLcode, size_t> errors;
+  std::map<hypr::StatusCode, size_t> statuses;
+  Clock::duration elapsed{0};
+};
+
+void print_usage() {
+  std::cerr << "Usage: hypr-bench [--rate N] [--duration S] "
+               "[--concurrency N] [--method M] [--header H]... [--body B] "
+               "[--timeout MS] <url>...\n";
+}
+
+bool parse_args(int argc, char* argv[], Config& config) {
+  std::string method = "GET";
+  std::vector<std::pair<std::string, std::string>> headers;
+  std::string body;
+  std::vector<std::string> urls;
+
+  for (int i = 1; i < argc; ++i) {
+    const std::string_view arg = argv[i];
+    const auto next = [&]() -> const char* {
+      return i + 1 < argc ? argv[++i] : nullptr;
+    };
+
+    if (arg == "--rate") {
+      const auto value = next();
+      if (!value) return false;
+      config.rate = std::atof(value);
+    } else if (arg == "--duration") {
+      const auto value = next();
+      if (!value) return false;
+      config.duration = std::chrono::seconds{std::atoll(value)};
+    } else if (arg == "--concurrency") {
+      const auto value = next();
+      if (!value) return false;
+      config.concurrency = static_cast<size_t>(std::atoll(value));
+    } else if (arg == "--method") {
+      const auto value = next();
+      if (!value) return false;
+      method = value;
+    } else if (arg == "--header") {
+      const auto value = next();
+      if (!value) return false;
+      const std::string_view header = value;
+      const auto pos = header.find(':');
+      if (pos == header.npos) return false;
+      auto header_value = header.substr(pos + 1);
+      while (!header_value.empty() && header_value.front() == ' ') {
+        header_value.remove_prefix(1);
+      }
+      headers.emplace_back(header.substr(0, pos), header_value);
+    } else if (arg == "--body") {
+      const auto value = next();
+      if (!value) return false;
+      body = value;
+    } else if (arg == "--timeout") {
+      const auto value = next();
+      if (!value) return false;
+      config.timeout = std::chrono::milliseconds{std::atoll(value)};
+    } else if (arg.substr(0, 2) == "--") {
+      return false;
+    } else {
+      urls.emplace_back(arg);
+    }
+  }
+
+  if (urls.empty() || config.rate <= 0 || !config.concurrency) {
+    return false;
+  }
+
+  for (const auto& url : urls) {
+    hypr::Request request;
+    if (!request.set_method(method) || !request.set_target(url)) {
+      std::cerr << "Invalid request: " << method << ' ' << url << '\n';
+      return false;
+    }
+    for (const auto& [name, value] : headers) {
+      request.add_header(name, value);
+    }
+    if (!body.empty()) {
+      request.set_body(hypr::Body{body});
+    }
+    config.requests.push_back(std::move(request));
+  }
+
+  return true;
+}
+
+Results run(const Config& config) {
+  Results results;
+
+  hypr::Client client;
+  client.options.total_timeout = config.timeout;
+
+  const auto interval = std::chrono::duration_cast<Clock::duration>(
+      std::chrono::duration<double>{1.0 / config.rate});
+  const auto start = Clock::now();
+  const auto end = start + config.duration;
+
+  // Scheduled start times of requests that are waiting for a free slot
+  std::deque<Clock::time_point> backlog;
+  auto next_arrival = start;
+  size_t sent = 0;
+  size_t in_flight = 0;
+
+  while (true) {
+    const auto now = Clock::now();
+
+    for (; next_arrival <= now && next_arrival < end;
+         next_arrival += interval) {
+      backlog.push_back(next_arrival);
+    }
+
+    while (!backlog.empty() && in_flight < config.concurrency) {
+      const auto scheduled = backlog.front();
+      backlog.pop_front();
+      ++in_flight;
+
+      const auto& request = config.requests[sent++ % config.requests.size()];
+      client.send_async(request, [&, scheduled](hypr::Response&& response) {
+        --in_flight;
+        const auto latency = Clock::now() - scheduled;
+        results.latencies.push_back(
+            std::chrono::duration_cast<std::chrono::microseconds>(latency)
+                .count());
+        if (response.error()) {
+          ++results.errors[response.error().code];
+        } else {
+          ++results.statuses[response.status_code()];
+        }
+      });
+    }
+
+    if (next_arrival >= end && backlog.empty() && !in_flight) {
+      break;
+    }
+
+    const auto timeout = std::chrono::duration_cast<std::chrono::milliseconds>(
+        next_arrival < end ? next_arrival - Clock::now()
+                           : std::chrono::milliseconds{100});
+    client.poll(std::max(timeout, std::chrono::milliseconds{0}));
+  }
+
+  results.elapsed = Clock::now() - start;
+
+  return results;
+}
+
+void print_results(const Config& config, Results& results) {
+  auto& latencies = results.latencies;
+  std::sort(latencies.begin(), latencies.end());
+
+  const auto percentile = [&latencies](const double p) -> double {
+    if (latencies.empty()) {
+      return 0;
+    }
+    const auto index = static_cast<size_t>(p / 100 * (latencies.size() - 1));
+    return latencies[index] / 1000.0;
+  };
+
+  const auto seconds =
+      std::chrono::duration<double>{results.elapsed}.count();
+
+  std::cout << std::fixed << std::setprecision(2);
+  std::cout << "Requests:    " << latencies.size() << '\n';
+  std::cout << "Throughput:  " << latencies.size() / seconds << " req/s"
+            << " (target " << config.rate << ")\n";
+  std::cout << "Latency (ms):\n";
+  const std::pair<const char*, double> percentiles[] = {
+      {"p50", 50}, {"p90", 90}, {"p99", 99}, {"p99.9", 99.9}, {"max", 100}};
+  for (const auto& [name, p] : percentiles) {
+    std::cout << "  " << std::setw(6) << std::left << name << std::right
+              << std::setw(10) << percentile(p) << '\n';
+  }
+
+  std::cout << "Status codes:\n";
+  for (const auto& [status, count] : results.statuses) {
+    std::cout << "  " << status << ": " << count << '\n';
+  }
+
+  if (!results.errors.empty()) {
+    std::cout << "Errors:\n";
+    for (const auto& [code, count] : results.errors) {
+      std::cout << "  " << curl_easy_strerror(code) << " (" << code
+                << "): " << count << '\n';
+    }
+  }
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  Config config;
+  if (!parse_args(argc, argv, config)) {
+    print_usage();
+    return 1;
+  }
+
+  if (!hypr::init()) {
+    std::cerr << "Could not initialize libcurl\n";
+    return 1;
+  }
+
+  auto results = run(config);
+  print_results(config, results);
+
+  return results.errors.empty() ? 0 : 2;
+}